@@ -0,0 +1,34 @@
+#include "adjudicate.h"
+#include <stdlib.h>
+
+void Adjudicator::Reset(){
+    win_count = 0;
+    draw_count = 0;
+}
+
+int Adjudicator::Update(const AdjudicationConfig& config, bool searched, int red_score, int round, bool revealed, std::string* reason){
+    if(!searched){
+        Reset();
+        return ADJUDICATE_NONE;
+    }
+    if(red_score >= config.win_score){
+        win_count = win_count > 0 ? win_count + 1 : 1;
+    }else if(red_score <= -config.win_score){
+        win_count = win_count < 0 ? win_count - 1 : -1;
+    }else{
+        win_count = 0;
+    }
+    draw_count = (revealed && round >= config.draw_round && abs(red_score) <= config.draw_score) ? draw_count + 1 : 0;
+    char buffer[128];
+    if(config.win_plies > 0 && abs(win_count) >= config.win_plies){
+        snprintf(buffer, sizeof(buffer), "%s score >= %d for %d plies", win_count > 0 ? "red" : "black", config.win_score, abs(win_count));
+        *reason = buffer;
+        return win_count > 0 ? ADJUDICATE_RED : ADJUDICATE_BLACK;
+    }
+    if(config.draw_plies > 0 && draw_count >= config.draw_plies){
+        snprintf(buffer, sizeof(buffer), "|score| <= %d for %d plies, no dark pieces, round %d", config.draw_score, draw_count, round);
+        *reason = buffer;
+        return ADJUDICATE_DRAW;
+    }
+    return ADJUDICATE_NONE;
+}
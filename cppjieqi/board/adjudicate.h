@@ -0,0 +1,34 @@
+#ifndef adjudicate_h
+#define adjudicate_h
+
+#include <string>
+#include <stdio.h>
+
+#define ADJUDICATE_NONE 0
+#define ADJUDICATE_RED 1 //判红胜
+#define ADJUDICATE_BLACK 2 //判黑胜
+#define ADJUDICATE_DRAW 3 //判和
+
+//players.conf里的adjudicate.key=value, 出现任何一个就打开; plies为0表示不做这一种判定
+//判胜: 连续win_plies步(双方各自的搜索)都认为同一方领先至少win_score
+//判和: 棋盘上没有暗子, 到了第draw_round轮以后, 连续draw_plies步双方的分数绝对值都不超过draw_score
+struct AdjudicationConfig{
+    bool enabled = false;
+    int win_score = 1000;
+    int win_plies = 10;
+    int draw_score = 15;
+    int draw_plies = 20;
+    int draw_round = 40;
+};
+
+//一局一个, 每走一步喂一次分数
+struct Adjudicator{
+    int win_count = 0; //连续多少步同一方领先, 正数红方负数黑方
+    int draw_count = 0;
+    void Reset();
+    //searched为false(人、开局库、开局前缀)时计数清零; red_score是红方视角的分数
+    //有结论时返回ADJUDICATE_RED/BLACK/DRAW并在reason里写上原因
+    int Update(const AdjudicationConfig& config, bool searched, int red_score, int round, bool revealed, std::string* reason);
+};
+
+#endif
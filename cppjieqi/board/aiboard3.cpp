@@ -75,6 +75,9 @@ char board::AIBoard3::_dir[91][8] = {{0}};
 std::unordered_map<std::string, SCORE3> score_bean3;
 std::unordered_map<std::string, KONGTOUPAO_SCORE3> kongtoupao_score_bean3;
 std::unordered_map<std::string, THINKER3> thinker_bean3;
+//注册表和_dir都在静态初始化时填好, 之后只读, 多线程同时构造AIBoard3也不会写它们
+int score_functions3 = (register_score_functions3(), 0);
+const bool board::AIBoard3::_dir_initialized = (_initialize_dir(), true);
 
 board::AIBoard3::AIBoard3() noexcept:
                     lastinsert(false),
@@ -90,6 +93,7 @@ board::AIBoard3::AIBoard3() noexcept:
                     _has_initialized(false),
                     _score_func(NULL),
                     _kongtoupao_score_func(NULL){
+    this -> context = DefaultContext();
     SetScoreFunction("complicated_score_function3", 0);
     SetScoreFunction("complicated_kongtoupao_score_function3", 1);
     tp_score.clear();
@@ -99,18 +103,16 @@ board::AIBoard3::AIBoard3() noexcept:
     memset(state_black, 0, sizeof(state_black));
     strncpy(state_red, _initial_state, _chess_board_size);
     strncpy(state_black, _initial_state, _chess_board_size);
-    copy_pst(this -> pst, ::pstglobal[2]);
-    _initialize_dir();
+    this -> pst = this -> context -> pst[2];
     _initialize_zobrist();
     zobrist_cache.insert((zobrist_hash << 1)|original_turn);
     Scan();
-    register_score_functions3();
     read_kaijuku(_kaijuku_file, kaijuku);
     _has_initialized = true;
 }
 
 
-board::AIBoard3::AIBoard3(const char another_state[MAX], bool turn, int round, const unsigned char di[VERSION_MAX][2][123], short score, std::unordered_map<std::string, bool>* hist) noexcept: 
+board::AIBoard3::AIBoard3(const char another_state[MAX], bool turn, int round, const unsigned char di[VERSION_MAX][2][123], short score, std::unordered_map<std::string, bool>* hist, EngineContext* context) noexcept: 
                                                                                                                             lastinsert(false),
                                                                                                                             version(0), 
                                                                                                                             round(round), 
@@ -124,6 +126,7 @@ board::AIBoard3::AIBoard3(const char another_state[MAX], bool turn, int round, c
                                                                                                                             _has_initialized(false),
                                                                                                                             _score_func(NULL),
                                                                                                                             _kongtoupao_score_func(NULL){
+    this -> context = context ? context : DefaultContext();
     SetScoreFunction("complicated_score_function3", 0);
     SetScoreFunction("complicated_kongtoupao_score_function3", 1);
     tp_score.clear();
@@ -138,13 +141,11 @@ board::AIBoard3::AIBoard3(const char another_state[MAX], bool turn, int round, c
     }else{
         rotate(state_red);
     }
-    copy_pst(this -> pst, ::pstglobal[2]);
+    this -> pst = this -> context -> pst[2];
     CopyData(di);
-    _initialize_dir();
     _initialize_zobrist();
     zobrist_cache.insert((zobrist_hash << 1)|original_turn);
     Scan();
-    register_score_functions3();
     if(round == 0){
         read_kaijuku(_kaijuku_file, kaijuku);
     }
@@ -240,8 +241,8 @@ bool board::AIBoard3::Move(const unsigned char encode_from, const unsigned char
     const unsigned char reverse_encode_to = reverse(encode_to);
     if(turn){
         cache.push({encode_from, encode_to, state_red[encode_to]});
-        zobrist_hash ^= _zobrist[(int)state_red[encode_to]][encode_to];
-        zobrist_hash ^= _zobrist[(int)state_red[encode_from]][encode_from];
+        zobrist_hash ^= _zobrist[SID(state_red[encode_to])][SQ(encode_to)];
+        zobrist_hash ^= _zobrist[SID(state_red[encode_from])][SQ(encode_from)];
         if(state_red[encode_from] >= 'D' && state_red[encode_from] <= 'I'){
             state_red[encode_to] = 'U';
             state_red[encode_from] = '.';
@@ -253,11 +254,11 @@ bool board::AIBoard3::Move(const unsigned char encode_from, const unsigned char
             state_black[reverse_encode_to] = state_black[reverse_encode_from];
             state_black[reverse_encode_from] = '.';
         }
-        zobrist_hash ^= _zobrist[(int)state_red[encode_to]][encode_to];
+        zobrist_hash ^= _zobrist[SID(state_red[encode_to])][SQ(encode_to)];
     } else{
         cache.push({encode_from, encode_to, state_black[encode_to]});
-        zobrist_hash ^= _zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
-        zobrist_hash ^= _zobrist[(int)state_red[reverse_encode_from]][reverse_encode_from];
+        zobrist_hash ^= _zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
+        zobrist_hash ^= _zobrist[SID(state_red[reverse_encode_from])][SQ(reverse_encode_from)];
         if(state_black[encode_from] >= 'D' && state_black[encode_from] <= 'I'){
             state_black[encode_to] = 'U';
             state_black[encode_from] = '.';
@@ -269,7 +270,7 @@ bool board::AIBoard3::Move(const unsigned char encode_from, const unsigned char
             state_red[reverse_encode_to] = state_red[reverse_encode_from];
             state_red[reverse_encode_from] = '.';
         }
-        zobrist_hash ^= _zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
+        zobrist_hash ^= _zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
     }
     turn = !turn;
     score = -(score + score_step);
@@ -314,7 +315,7 @@ void board::AIBoard3::UndoMove(int type){
         const unsigned char reverse_encode_from = reverse(encode_from);
         const unsigned char reverse_encode_to = reverse(encode_to);
         if(turn){
-            zobrist_hash ^= _zobrist[(int)state_red[encode_to]][encode_to];
+            zobrist_hash ^= _zobrist[SID(state_red[encode_to])][SQ(encode_to)];
             if(state_red[encode_to] == 'U'){
                 state_red[encode_from] = LUT3[encode_from];
                 state_red[encode_to] = eat;
@@ -326,10 +327,10 @@ void board::AIBoard3::UndoMove(int type){
                 state_black[reverse_encode_from] = state_black[reverse_encode_to];
                 state_black[reverse_encode_to] = swapcase(eat);
             }
-            zobrist_hash ^= _zobrist[(int)state_red[encode_from]][encode_from];
-            zobrist_hash ^= _zobrist[(int)state_red[encode_to]][encode_to];
+            zobrist_hash ^= _zobrist[SID(state_red[encode_from])][SQ(encode_from)];
+            zobrist_hash ^= _zobrist[SID(state_red[encode_to])][SQ(encode_to)];
         }else{
-            zobrist_hash ^= _zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
+            zobrist_hash ^= _zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
             if(state_black[encode_to] == 'U'){
                 state_black[encode_from] = LUT3[encode_from];
                 state_black[encode_to] = eat;
@@ -341,8 +342,8 @@ void board::AIBoard3::UndoMove(int type){
                 state_red[reverse_encode_from] = state_red[reverse_encode_to];
                 state_red[reverse_encode_to] = swapcase(eat);
             }
-            zobrist_hash ^= _zobrist[(int)state_red[reverse_encode_from]][reverse_encode_from];
-            zobrist_hash ^= _zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
+            zobrist_hash ^= _zobrist[SID(state_red[reverse_encode_from])][SQ(reverse_encode_from)];
+            zobrist_hash ^= _zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
         }
         //Scan(); //这里不需要再Scan，因为Scan是用来统计移动分数的和Quiescence的，Move之前就应该已经统计完成
     }else if(type == 0){
@@ -371,7 +372,7 @@ void board::AIBoard3::Scan(){
             ++all;
         }
         if(p == 'R' || p == 'N' || p == 'B' || p == 'A' || p == 'K' || p == 'C' || p == 'P'){
-            score_rough += pst[(int)p][i];
+            score_rough += pst[PID(p)][SQ(i)];
             if(p == 'R'){
                ++che;
             }else if(p == 'P'){
@@ -382,11 +383,11 @@ void board::AIBoard3::Scan(){
             ++covered;
         }
         else if(p == 'U'){
-            score_rough += aiaverage[version][turn?1:0][1][i];
+            score_rough += aiaverage[version][turn?1:0][1][SQ(i)];
             ++covered;
         }
         else if(p == 'r' || p == 'n' || p == 'b' || p == 'a' || p == 'k' || p == 'c' || p == 'p'){
-            score_rough -= pst[((int)p) ^ 32][254 - i];
+            score_rough -= pst[PID(p ^ 32)][SQ(254 - i)];
             if(p == 'r'){
                ++che_opponent;
             }
@@ -395,7 +396,7 @@ void board::AIBoard3::Scan(){
             ++covered_opponent;
         }  
         else if(p == 'u'){
-            score_rough -= aiaverage[version][turn?0:1][1][254 - i];
+            score_rough -= aiaverage[version][turn?0:1][1][SQ(254 - i)];
             ++covered_opponent;
         }
         if(p == 'C' && ((i & 15) == 7)){
@@ -450,7 +451,7 @@ short board::AIBoard3::ScanProtectors(){
     const short delta = 10;
     for(int i = 0; i < 20; ++i){
         if(_state_pointer[penaltyareaoppo[i]] == 'P'){
-            short tmp = (delta * (4 - L1[penaltyareaoppo[i]][71]) * oppo);
+            short tmp = (delta * (4 - L1[SQ(penaltyareaoppo[i])][SQ(71)]) * oppo);
             if(penaltyareaoppo[i] <= 57){
                 //底兵
                 tmp /= 2;
@@ -459,7 +460,7 @@ short board::AIBoard3::ScanProtectors(){
             bonus += tmp;
         }
         if(_state_pointer[penaltyarea[i]] == 'p'){
-            short tmp = (delta * (4 - L1[penaltyarea[i]][183]) * myself);
+            short tmp = (delta * (4 - L1[SQ(penaltyarea[i])][SQ(183)]) * myself);
             if(penaltyarea[i] >= 197){
                 tmp /= 2;
             }
@@ -761,13 +762,13 @@ void board::AIBoard3::CopyData(const unsigned char di[VERSION_MAX][2][123]){
         if(numr > 0){
             double sumr = 0.0;
             for(const char c : MINGZI){
-                sumr += pst[(int)c][0] * aidi[ver][1][(int)c] / discount_factor;
+                sumr += pst[PID(c)][AVERAGE_SLOT] * aidi[ver][1][(int)c] / discount_factor;
             }
-            aiaverage[ver][1][0][0] = ::round(sumr / numr);
-            for(int i = 51; i <= 203; ++i){
+            aiaverage[ver][1][0][AVERAGE_SLOT] = ::round(sumr / numr);
+            for(int i = 0; i < SQUARE_NUM; ++i){
                 sumr = 0.0;
                 for(const char c : MINGZI){
-                    sumr += pst[(int)c][i] * aidi[ver][1][(int)c];
+                    sumr += pst[PID(c)][i] * aidi[ver][1][(int)c];
                 }
                 aiaverage[ver][1][1][i] = ::round(sumr / numr);
             }
@@ -775,13 +776,13 @@ void board::AIBoard3::CopyData(const unsigned char di[VERSION_MAX][2][123]){
         if(numb > 0){
             double sumb = 0.0;
             for(const char c : MINGZI){
-                sumb += pst[(int)c][0] * aidi[ver][0][((int)c)^32] / discount_factor;
+                sumb += pst[PID(c)][AVERAGE_SLOT] * aidi[ver][0][((int)c)^32] / discount_factor;
             }
-            aiaverage[ver][0][0][0] = ::round(sumb / numb);
-            for(int i = 51; i <= 203; ++i){
+            aiaverage[ver][0][0][AVERAGE_SLOT] = ::round(sumb / numb);
+            for(int i = 0; i < SQUARE_NUM; ++i){
                 sumb = 0.0;
                 for(const char c : MINGZI){
-                    sumb += pst[(int)c][i] * aidi[ver][0][((int)c)^32];
+                    sumb += pst[PID(c)][i] * aidi[ver][0][((int)c)^32];
                 }
                 aiaverage[ver][0][1][i] = ::round(sumb / numb);
             }
@@ -794,7 +795,7 @@ std::string board::AIBoard3::Kaiju(){
         #if DEBUG
         return _thinker_func(this);
         #else
-        int key = rand() % 100;
+        int key = context -> Random(100);
         if(key < 20){
             return "a3a4";
         }else if(key < 40){
@@ -820,6 +821,7 @@ std::string board::AIBoard3::Kaiju(){
 }
 
 std::string board::AIBoard3::Think(){
+    ReadLimits();
     SetScoreFunction("mtd_thinker3", 2);
     return round == 0 ? Kaiju() : _thinker_func(this);
 }
@@ -912,7 +914,7 @@ short complicated_score_function3(board::AIBoard3* bp, const char* state_pointer
         return MATE_UPPER;
     }
     if(p == 'R' || p == 'N' || p == 'B' || p == 'A' || p == 'K' || p == 'C' || p == 'P'){
-        score =  bp -> pst[intp][dst] -  bp -> pst[intp][src];
+        score =  bp -> pst[PID(intp)][SQ(dst)] -  bp -> pst[PID(intp)][SQ(src)];
         
         if(p == 'R'){
             if(state_pointer[51] != 'd' && state_pointer[51] != 'r' && state_pointer[54] != 'a' && state_pointer[71] != 'a' && (state_pointer[71] == 'p' || state_pointer[87] != 'n')){
@@ -929,9 +931,9 @@ short complicated_score_function3(board::AIBoard3* bp, const char* state_pointer
     }
     
     else{
-        score = bp -> aiaverage[version][turn][1][dst] - bp -> aiaverage[version][turn][0][0];
+        score = bp -> aiaverage[version][turn][1][SQ(dst)] - bp -> aiaverage[version][turn][0][AVERAGE_SLOT];
         float che_zu_possibility = bp -> aisumall[version][turn] > 0 ? (bp -> aidi[version][turn][che_char] + bp -> aidi[version][turn][zu_char])/bp -> aisumall[version][turn] : 0.0;
-        float scorediff = bp -> aiaverage[version][turn][0][0] * che_zu_possibility;
+        float scorediff = bp -> aiaverage[version][turn][0][AVERAGE_SLOT] * che_zu_possibility;
         if(p == 'D'){
 
             if(bp -> score_rough < -150){
@@ -1022,7 +1024,7 @@ short complicated_score_function3(board::AIBoard3* bp, const char* state_pointer
         }else if(p == 'H'){
 
             if(src == 164 && dst == 68 && state_pointer[52] == 'e'){
-                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][0]/2);
+                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][AVERAGE_SLOT]/2);
                 score += bonus/2;
                 if(state_pointer[53] != '.'){ //python BUG
                     score += bonus;
@@ -1033,7 +1035,7 @@ short complicated_score_function3(board::AIBoard3* bp, const char* state_pointer
             }
             
             if(src == 170 && dst == 74 && state_pointer[58] == 'e'){
-                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][0]/2);
+                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][AVERAGE_SLOT]/2);
                 score += bonus/2;
                 if(state_pointer[57] != '.'){ //python BUG
                     score += bonus;
@@ -1063,13 +1065,13 @@ short complicated_score_function3(board::AIBoard3* bp, const char* state_pointer
     if(q >= 'A' && q <= 'Z'){
         int k = 254 - dst;
         if(q == 'R' || q == 'N' || q == 'B' || q == 'A' || q == 'C' || q == 'P'){
-            score +=  bp -> pst[intq][k];
+            score +=  bp -> pst[PID(intq)][SQ(k)];
         }
         else{
             if(q != 'U'){
-                score += bp -> aiaverage[version][1 - turn][0][0];              
+                score += bp -> aiaverage[version][1 - turn][0][AVERAGE_SLOT];              
             }else{
-                score += bp -> aiaverage[version][1 - turn][1][k];
+                score += bp -> aiaverage[version][1 - turn][1][SQ(k)];
             }
             if(q == 'D'){
                 if(bp -> score_rough > 150){
@@ -1140,11 +1142,11 @@ std::string mtd_thinker3(board::AIBoard3* bp){
     constexpr short EVAL_ROBUSTNESS = 0;
     bp -> Scan();
     bool traverse_all_strategy = true;
-    int max_depth = (bp -> round < 15?6:7);
+    int max_depth = bp -> limits.MaxDepth(bp -> round < 15?6:7);
     int quiesc_depth = (bp -> round < 15?1:0);
     int depth = 0;
     auto start = std::chrono::high_resolution_clock::now();
-    for(depth = 5; depth <= max_depth; ++depth){
+    for(depth = bp -> limits.MinDepth(5, max_depth); depth <= max_depth; ++depth){
         #if CLEAR_EVERY_ROOT
         bp -> tp_score.clear();
         bp -> tp_move.clear();
@@ -1158,7 +1160,9 @@ std::string mtd_thinker3(board::AIBoard3* bp){
         }
         mtd_alphabeta3(bp, lower, depth + quiesc_depth, true, true, true, quiesc_depth, traverse_all_strategy);
         size_t int_ms = (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
-        if(int_ms > 50000 || depth == max_depth){
+        if(bp -> limits.Stop(depth, max_depth, bp -> search_nodes, int_ms)){
+            bp -> search_score = lower;
+            bp -> search_depth = depth + quiesc_depth;
             auto move = bp -> tp_move[{bp -> zobrist_hash, bp -> turn}];
             if(move == std::pair<unsigned char, unsigned char>({0, 0})){
                 unsigned char mate_src = 0, mate_dst = 0;
@@ -1167,12 +1171,12 @@ std::string mtd_thinker3(board::AIBoard3* bp){
                 bool killer_is_alive = false;
                 short killer_score = 0;
                 bp -> GenMovesWithScore<true, false>(legal_moves_tmp, num_of_legal_moves_tmp, NULL, killer_score, mate_src, mate_dst, killer_is_alive);
-                std::cout << "My name: " << bp -> GetName() << " [AM I FAILED?]" << num_of_legal_moves_tmp << " My move: " << bp -> translate_ucci(std::get<1>(legal_moves_tmp[0]), std::get<2>(legal_moves_tmp[0])) << ", duration = " << int_ms << ", depth = " << depth + quiesc_depth << "." << std::endl;
+                std::cout << "My name: " << bp -> GetName() << " [AM I FAILED?]" << num_of_legal_moves_tmp << " My move: " << bp -> translate_ucci(std::get<1>(legal_moves_tmp[0]), std::get<2>(legal_moves_tmp[0])) << ", duration = " << int_ms << ", depth = " << depth + quiesc_depth << ", nodes = " << bp -> search_nodes << "." << std::endl;
                 if(num_of_legal_moves_tmp != 0){
                     return bp -> translate_ucci(std::get<1>(legal_moves_tmp[0]), std::get<2>(legal_moves_tmp[0]));
                 }
             }
-            std::cout << "My name: " << bp -> GetName() <<  " My move: " << bp -> translate_ucci(move.first, move.second) << ", duration = " << int_ms << ", depth = " << depth + quiesc_depth << "." << std::endl;
+            std::cout << "My name: " << bp -> GetName() <<  " My move: " << bp -> translate_ucci(move.first, move.second) << ", duration = " << int_ms << ", depth = " << depth + quiesc_depth << ", nodes = " << bp -> search_nodes << "." << std::endl;
             return bp -> translate_ucci(move.first, move.second);
         }
     }
@@ -1180,6 +1184,8 @@ std::string mtd_thinker3(board::AIBoard3* bp){
 }
 
 short mtd_quiescence3(board::AIBoard3* self, const short gamma, int quiesc_depth, const bool root){
+    ++self -> search_nodes;
+    ++self -> search_qnodes;
     constexpr short MATE_UPPER = 3696;
     constexpr int TOPK = 3;
     unsigned char mate_src = 0, mate_dst = 0;
@@ -1202,7 +1208,9 @@ short mtd_quiescence3(board::AIBoard3* self, const short gamma, int quiesc_depth
     }
     std::pair<short, short> entry(-MATE_UPPER, MATE_UPPER);
     std::pair<uint32_t, int> pair = {self -> zobrist_hash, (quiesc_depth << 1) + (int)self -> turn};
+    ++self -> tt_probes;
     if(self -> tp_score.find(pair) != self -> tp_score.end()){
+        ++self -> tt_hits;
         entry = self -> tp_score[pair];
     }
     if(entry.first >= gamma){
@@ -1255,6 +1263,7 @@ short mtd_quiescence3(board::AIBoard3* self, const short gamma, int quiesc_depth
 }
 
 short mtd_alphabeta3(board::AIBoard3* self, const short gamma, int depth, const bool root, const bool nullmove, const bool nullmove_now, const int quiesc_depth, const bool traverse_all_strategy){
+    ++self -> search_nodes;
     constexpr short MATE_UPPER = 3696;
     unsigned char mate_src = 0, mate_dst = 0;
     if(root) { 
@@ -1288,7 +1297,9 @@ short mtd_alphabeta3(board::AIBoard3* self, const short gamma, int depth, const
     }
     std::pair<short, short> entry(-MATE_UPPER, MATE_UPPER);
     std::pair<uint32_t, int> pair = {self -> zobrist_hash, (depth << 1) + (int)self -> turn};
+    ++self -> tt_probes;
     if(self -> tp_score.find(pair) != self -> tp_score.end()){
+        ++self -> tt_hits;
         entry = self -> tp_score[pair];
     }
     if(entry.first >= gamma && (!root || killer_is_alive)){
@@ -76,6 +76,9 @@ char board::AIBoard4::_dir[91][8] = {{0}};
 std::unordered_map<std::string, SCORE4> score_bean4;
 std::unordered_map<std::string, KONGTOUPAO_SCORE4> kongtoupao_score_bean4;
 std::unordered_map<std::string, THINKER4> thinker_bean4;
+//注册表和_dir都在静态初始化时填好, 之后只读, 多线程同时构造AIBoard4也不会写它们
+int score_functions4 = (register_score_functions4(), 0);
+const bool board::AIBoard4::_dir_initialized = (_initialize_dir(), true);
 
 board::AIBoard4::AIBoard4() noexcept: 
                     lastinsert(false),
@@ -89,13 +92,16 @@ board::AIBoard4::AIBoard4() noexcept:
                     score(0),
                     tp_move(NULL),
                     tp_score(NULL),
+                    eval_cache(NULL),
                     _kaijuku_file("../kaijuku"),
                     _myname("AI4"),
                     _has_initialized(false),
                     _score_func(NULL),
                     _kongtoupao_score_func(NULL){
-    this -> tp_move = &tp_move_bean[4];
-    this -> tp_score = &tp_score_bean[4];
+    this -> context = DefaultContext();
+    this -> tp_move = &this -> context -> tp_move_bean[4];
+    this -> tp_score = &this -> context -> tp_score_bean[4];
+    this -> eval_cache = &this -> context -> eval_cache_bean[4];
     SetScoreFunction("complicated_score_function4", 0);
     SetScoreFunction("complicated_kongtoupao_score_function4", 1);
     score_cache.push(score);
@@ -103,18 +109,16 @@ board::AIBoard4::AIBoard4() noexcept:
     memset(state_black, 0, sizeof(state_black));
     strncpy(state_red, _initial_state, _chess_board_size);
     strncpy(state_black, _initial_state, _chess_board_size);
-    copy_pst(this -> pst, ::pstglobal[3]);
-    _initialize_dir();
+    this -> pst = this -> context -> pst[3];
     _initialize_zobrist();
     zobrist_cache.insert((zobrist_hash << 1)|original_turn);
     Scan();
-    register_score_functions4();
     read_kaijuku(_kaijuku_file, kaijuku);
     _has_initialized = true;
 }
 
 
-board::AIBoard4::AIBoard4(const char another_state[MAX], bool turn, int round, const unsigned char di[VERSION_MAX][2][123], short score, std::unordered_map<std::string, bool>* hist) noexcept: 
+board::AIBoard4::AIBoard4(const char another_state[MAX], bool turn, int round, const unsigned char di[VERSION_MAX][2][123], short score, std::unordered_map<std::string, bool>* hist, EngineContext* context) noexcept: 
                                                                                                                             lastinsert(false),
                                                                                                                             version(0), 
                                                                                                                             round(round), 
@@ -125,14 +129,17 @@ board::AIBoard4::AIBoard4(const char another_state[MAX], bool turn, int round, c
                                                                                                                             score(score),
                                                                                                                             tp_move(NULL),
                                                                                                                             tp_score(NULL),
+                                                                                                                            eval_cache(NULL),
                                                                                                                             hist(hist),
                                                                                                                             _kaijuku_file("../kaijuku"),
                                                                                                                             _myname("AI4"),
                                                                                                                             _has_initialized(false),
                                                                                                                             _score_func(NULL),
                                                                                                                             _kongtoupao_score_func(NULL){
-    this -> tp_move = &tp_move_bean[4];
-    this -> tp_score = &tp_score_bean[4];
+    this -> context = context ? context : DefaultContext();
+    this -> tp_move = &this -> context -> tp_move_bean[4];
+    this -> tp_score = &this -> context -> tp_score_bean[4];
+    this -> eval_cache = &this -> context -> eval_cache_bean[4];
     SetScoreFunction("complicated_score_function4", 0);
     SetScoreFunction("complicated_kongtoupao_score_function4", 1);
     score_cache.push(score);
@@ -145,13 +152,11 @@ board::AIBoard4::AIBoard4(const char another_state[MAX], bool turn, int round, c
     }else{
         rotate(state_red);
     }
-    copy_pst(this -> pst, ::pstglobal[3]);
+    this -> pst = this -> context -> pst[3];
     CopyData(di);
-    _initialize_dir();
     _initialize_zobrist();
     zobrist_cache.insert((zobrist_hash << 1)|original_turn);
     Scan();
-    register_score_functions4();
     if(round == 0){
         read_kaijuku(_kaijuku_file, kaijuku);
     }
@@ -245,10 +250,13 @@ std::string board::AIBoard4::SearchScoreFunction(int type){
 bool board::AIBoard4::Move(const unsigned char encode_from, const unsigned char encode_to, short score_step){
     const unsigned char reverse_encode_from = reverse(encode_from);
     const unsigned char reverse_encode_to = reverse(encode_to);
+    const unsigned char red_from = turn ? encode_from : reverse_encode_from;
+    const unsigned char red_to = turn ? encode_to : reverse_encode_to;
+    const char red_from_before = state_red[red_from], red_to_before = state_red[red_to];
     if(turn){
         cache.push({encode_from, encode_to, state_red[encode_to]});
-        zobrist_hash ^= zobrist[(int)state_red[encode_to]][encode_to];
-        zobrist_hash ^= zobrist[(int)state_red[encode_from]][encode_from];
+        zobrist_hash ^= zobrist[SID(state_red[encode_to])][SQ(encode_to)];
+        zobrist_hash ^= zobrist[SID(state_red[encode_from])][SQ(encode_from)];
         if(state_red[encode_from] >= 'D' && state_red[encode_from] <= 'I'){
             state_red[encode_to] = 'U';
             state_red[encode_from] = '.';
@@ -260,11 +268,11 @@ bool board::AIBoard4::Move(const unsigned char encode_from, const unsigned char
             state_black[reverse_encode_to] = state_black[reverse_encode_from];
             state_black[reverse_encode_from] = '.';
         }
-        zobrist_hash ^= zobrist[(int)state_red[encode_to]][encode_to];
+        zobrist_hash ^= zobrist[SID(state_red[encode_to])][SQ(encode_to)];
     } else{
         cache.push({encode_from, encode_to, state_black[encode_to]});
-        zobrist_hash ^= zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
-        zobrist_hash ^= zobrist[(int)state_red[reverse_encode_from]][reverse_encode_from];
+        zobrist_hash ^= zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
+        zobrist_hash ^= zobrist[SID(state_red[reverse_encode_from])][SQ(reverse_encode_from)];
         if(state_black[encode_from] >= 'D' && state_black[encode_from] <= 'I'){
             state_black[encode_to] = 'U';
             state_black[encode_from] = '.';
@@ -276,7 +284,10 @@ bool board::AIBoard4::Move(const unsigned char encode_from, const unsigned char
             state_red[reverse_encode_to] = state_red[reverse_encode_from];
             state_red[reverse_encode_from] = '.';
         }
-        zobrist_hash ^= zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
+        zobrist_hash ^= zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
+    }
+    if(nnue){
+        NNUEPush(red_from, red_from_before, red_to, red_to_before);
     }
     turn = !turn;
     score = -(score + score_step);
@@ -309,6 +320,9 @@ void board::AIBoard4::UndoMove(int type){
         zobrist_cache.erase((zobrist_hash<<1)|turn);
     }
     if(type == 1){//非空移动
+        if(nnue){
+            NNUEPop();
+        }
         const std::tuple<unsigned char, unsigned char, char> from_to_eat = cache.top();
         cache.pop();
         const unsigned char encode_from = std::get<0>(from_to_eat);
@@ -321,7 +335,7 @@ void board::AIBoard4::UndoMove(int type){
         const unsigned char reverse_encode_from = reverse(encode_from);
         const unsigned char reverse_encode_to = reverse(encode_to);
         if(turn){
-            zobrist_hash ^= zobrist[(int)state_red[encode_to]][encode_to];
+            zobrist_hash ^= zobrist[SID(state_red[encode_to])][SQ(encode_to)];
             if(state_red[encode_to] == 'U'){
                 state_red[encode_from] = LUT4[encode_from];
                 state_red[encode_to] = eat;
@@ -333,10 +347,10 @@ void board::AIBoard4::UndoMove(int type){
                 state_black[reverse_encode_from] = state_black[reverse_encode_to];
                 state_black[reverse_encode_to] = swapcase(eat);
             }
-            zobrist_hash ^= zobrist[(int)state_red[encode_from]][encode_from];
-            zobrist_hash ^= zobrist[(int)state_red[encode_to]][encode_to];
+            zobrist_hash ^= zobrist[SID(state_red[encode_from])][SQ(encode_from)];
+            zobrist_hash ^= zobrist[SID(state_red[encode_to])][SQ(encode_to)];
         }else{
-            zobrist_hash ^= zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
+            zobrist_hash ^= zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
             if(state_black[encode_to] == 'U'){
                 state_black[encode_from] = LUT4[encode_from];
                 state_black[encode_to] = eat;
@@ -348,8 +362,8 @@ void board::AIBoard4::UndoMove(int type){
                 state_red[reverse_encode_from] = state_red[reverse_encode_to];
                 state_red[reverse_encode_to] = swapcase(eat);
             }
-            zobrist_hash ^= zobrist[(int)state_red[reverse_encode_from]][reverse_encode_from];
-            zobrist_hash ^= zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
+            zobrist_hash ^= zobrist[SID(state_red[reverse_encode_from])][SQ(reverse_encode_from)];
+            zobrist_hash ^= zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
         }
         //Scan(); //这里不需要再Scan，因为Scan是用来统计移动分数的和Quiescence的，Move之前就应该已经统计完成
     }else if(type == 0){
@@ -378,7 +392,7 @@ void board::AIBoard4::Scan(){
             ++all;
         }
         if(p == 'R' || p == 'N' || p == 'B' || p == 'A' || p == 'K' || p == 'C' || p == 'P'){
-            score_rough += pst[(int)p][i];
+            score_rough += pst[PID(p)][SQ(i)];
             if(p == 'R'){
                ++che;
             }else if(p == 'P'){
@@ -389,11 +403,11 @@ void board::AIBoard4::Scan(){
             ++covered;
         }
         else if(p == 'U'){
-            score_rough += aiaverage[version][turn?1:0][1][i];
+            score_rough += aiaverage[version][turn?1:0][1][SQ(i)];
             ++covered;
         }
         else if(p == 'r' || p == 'n' || p == 'b' || p == 'a' || p == 'k' || p == 'c' || p == 'p'){
-            score_rough -= pst[((int)p) ^ 32][254 - i];
+            score_rough -= pst[PID(p ^ 32)][SQ(254 - i)];
             if(p == 'r'){
                ++che_opponent;
             }
@@ -402,7 +416,7 @@ void board::AIBoard4::Scan(){
             ++covered_opponent;
         }  
         else if(p == 'u'){
-            score_rough -= aiaverage[version][turn?0:1][1][254 - i];
+            score_rough -= aiaverage[version][turn?0:1][1][SQ(254 - i)];
             ++covered_opponent;
         }
         if(p == 'C' && ((i & 15) == 7)){
@@ -415,6 +429,22 @@ void board::AIBoard4::Scan(){
     _kongtoupao_score_func(this, &kongtoupao_score, &kongtoupao_score_opponent);
 }
 
+//局面分里和走子路径无关的部分(空头炮, 护卫), 先查缓存, 没命中才去Scan
+short board::AIBoard4::CachedEval(bool need_scan){
+    short positional = 0;
+    ++eval_cache_probes;
+    if(eval_cache -> probe(zobrist_hash, turn, &positional)){
+        ++eval_cache_hits;
+        return positional;
+    }
+    if(need_scan){
+        Scan();
+    }
+    positional = kongtoupao_score - kongtoupao_score_opponent + ScanProtectors();
+    eval_cache -> store(zobrist_hash, turn, positional);
+    return positional;
+}
+
 short board::AIBoard4::ScanProtectors(){
     const char *_state_pointer = turn?state_red:state_black;
     protector = 4;
@@ -457,7 +487,7 @@ short board::AIBoard4::ScanProtectors(){
     const short delta = 10;
     for(int i = 0; i < 20; ++i){
         if(_state_pointer[penaltyareaoppo[i]] == 'P'){
-            short tmp = (delta * (4 - L1[penaltyareaoppo[i]][71]) * oppo);
+            short tmp = (delta * (4 - L1[SQ(penaltyareaoppo[i])][SQ(71)]) * oppo);
             if(penaltyareaoppo[i] <= 57){
                 //底兵
                 tmp /= 2;
@@ -466,7 +496,7 @@ short board::AIBoard4::ScanProtectors(){
             bonus += tmp;
         }
         if(_state_pointer[penaltyarea[i]] == 'p'){
-            short tmp = (delta * (4 - L1[penaltyarea[i]][183]) * myself);
+            short tmp = (delta * (4 - L1[SQ(penaltyarea[i])][SQ(183)]) * myself);
             if(penaltyarea[i] >= 197){
                 tmp /= 2;
             }
@@ -534,6 +564,9 @@ bool board::AIBoard4::GenMovesWithScore(std::tuple<short, unsigned char, unsigne
     bool mate = false;
     killer_is_alive = false;
     const char *_state_pointer = turn?state_red:state_black;
+    if(needscore){
+        PrepareScoreContext(_state_pointer);
+    }
     for(unsigned char i = 51; i <= 203; ++i){
         if((i & 15) < 3 || (i & 15) > 11) { continue; }
         const char p = _state_pointer[i];
@@ -681,6 +714,7 @@ bool board::AIBoard4::GenMovesWithScore(std::tuple<short, unsigned char, unsigne
     }
     return mate;
 }//GenMovesWithScore()
+template bool board::AIBoard4::GenMovesWithScore<false, false>(std::tuple<short, unsigned char, unsigned char> legal_moves[MAX_POSSIBLE_MOVES], int& num_of_legal_moves, std::pair<unsigned char, unsigned char>* killer, short& killer_score, unsigned char& mate_src, unsigned char& mate_dst, bool& killer_is_alive); //perft.cpp要用
 
 
 template<bool doublereverse>
@@ -758,33 +792,70 @@ void board::AIBoard4::CalcVersion(const int ver, const float discount_factor){
     numr += aidi[ver][1][INTR]; numr += aidi[ver][1][INTN];  numr += aidi[ver][1][INTB];  numr += aidi[ver][1][INTA];  numr += aidi[ver][1][INTC]; numr += aidi[ver][1][INTP]; 
     numb += aidi[ver][0][INTr]; numb += aidi[ver][0][INTn];  numb += aidi[ver][0][INTb];  numb += aidi[ver][0][INTa];  numb += aidi[ver][0][INTc]; numb += aidi[ver][0][INTp]; 
     aisumall[ver][1] = numr; aisumall[ver][0] = numb;
-    if(numr > 0){
-        double sumr = 0.0;
+    for(int i = 0; i < SQUARE_NUM; ++i){
+        int sumr = 0, sumb = 0;
         for(const char c : MINGZI){
-            sumr += pst[(int)c][0] * aidi[ver][1][(int)c] / discount_factor;
-        }
-        for(int i = 51; i <= 203; ++i){
-            sumr = 0.0;
-            for(const char c : MINGZI){
-                sumr += pst[(int)c][i] * aidi[ver][1][(int)c];
-            }
-            aiaverage[ver][1][1][i] = ::round(sumr / numr);
+            sumr += pst[PID(c)][i] * aidi[ver][1][(int)c];
+            sumb += pst[PID(c)][i] * aidi[ver][0][((int)c)^32];
         }
+        aisum[ver][1][i] = sumr;
+        aisum[ver][0][i] = sumb;
+    }
+    CalcAverage(ver, 1, discount_factor);
+    CalcAverage(ver, 0, discount_factor);
+}
+
+void board::AIBoard4::CalcAverage(const int ver, const int side, const float discount_factor){
+    const short num = aisumall[ver][side];
+    if(num <= 0){
+        return;
     }
-    if(numb > 0){
+    if(side == 0){ //红方的[0][AVERAGE_SLOT]一直没有写, 保持原来的行为
         double sumb = 0.0;
         for(const char c : MINGZI){
-            sumb += pst[(int)c][0] * aidi[ver][0][((int)c)^32] / discount_factor;
-        }
-        aiaverage[ver][0][0][0] = ::round(sumb / numb);
-        for(int i = 51; i <= 203; ++i){
-            sumb = 0.0;
-            for(const char c : MINGZI){
-                sumb += pst[(int)c][i] * aidi[ver][0][((int)c)^32];
-            }
-            aiaverage[ver][0][1][i] = ::round(sumb / numb);
+            sumb += pst[PID(c)][AVERAGE_SLOT] * aidi[ver][0][((int)c)^32] / discount_factor;
         }
+        aiaverage[ver][0][0][AVERAGE_SLOT] = ::round(sumb / num);
+    }
+    for(int i = 0; i < SQUARE_NUM; ++i){
+        aiaverage[ver][side][1][i] = ::round((double)aisum[ver][side][i] / num);
+    }
+}
+
+void board::AIBoard4::RemoveFromPool(const int ver, const int side, const int intchar, const float discount_factor){
+    average_deltas.emplace_back();
+    AverageDelta& delta = average_deltas.back();
+    delta.ver = ver;
+    delta.side = side;
+    delta.intchar = intchar;
+    delta.average_slot = aiaverage[ver][0][0][AVERAGE_SLOT];
+    memcpy(delta.average, aiaverage[ver][side][1], sizeof(delta.average));
+    if(nnue){
+        NNUEPoolFeature(ver, side, intchar, aidi[ver][side][intchar], false);
+    }
+    --aidi[ver][side][intchar];
+    --aisumall[ver][side];
+    const short* row = pst[PID(side ? intchar : intchar ^ 32)];
+    for(int i = 0; i < SQUARE_NUM; ++i){
+        aisum[ver][side][i] -= row[i];
+    }
+    CalcAverage(ver, side, discount_factor);
+}
+
+void board::AIBoard4::ReturnToPool(){
+    const AverageDelta& delta = average_deltas.back();
+    ++aidi[delta.ver][delta.side][delta.intchar];
+    ++aisumall[delta.ver][delta.side];
+    if(nnue){
+        NNUEPoolFeature(delta.ver, delta.side, delta.intchar, aidi[delta.ver][delta.side][delta.intchar], true);
+    }
+    const short* row = pst[PID(delta.side ? delta.intchar : delta.intchar ^ 32)];
+    for(int i = 0; i < SQUARE_NUM; ++i){
+        aisum[delta.ver][delta.side][i] += row[i];
     }
+    aiaverage[delta.ver][0][0][AVERAGE_SLOT] = delta.average_slot;
+    memcpy(aiaverage[delta.ver][delta.side][1], delta.average, sizeof(delta.average));
+    average_deltas.pop_back();
 }
 
 void board::AIBoard4::CopyData(const unsigned char di[VERSION_MAX][2][123]){
@@ -798,12 +869,111 @@ void board::AIBoard4::CopyData(const unsigned char di[VERSION_MAX][2][123]){
     CalcVersion(0, discount_factor);
 }
 
+//players.conf里的选项, AIBoard每步都新建, 所以每步Think之前都要读一次
+void board::AIBoard4::ApplyOptions(){
+    ReadLimits();
+    if(!options){
+        return;
+    }
+    const std::string eval = GetWithDefUnordered<std::string, std::string>(*options, "eval", "hce");
+    if(eval == "nnue"){
+        nnue = GetNNUE(GetWithDefUnordered<std::string, std::string>(*options, "nnue", "../jieqi.nnue")); //读失败就还是手写评估
+    }else if(eval != "hce"){
+        printf("未知的评估%s, 用手写评估\n", eval.c_str());
+    }
+    if(nnue){
+        this -> tp_move = &this -> context -> tp_move_bean[NNUE_BEAN];
+        this -> tp_score = &this -> context -> tp_score_bean[NNUE_BEAN];
+        NNUERefresh();
+    }
+}
+
+void board::AIBoard4::NNUERefresh(){
+    if(nnue_stack.empty()){
+        nnue_stack.resize(128);
+    }
+    nnue_top = 0;
+    NNUEAccumulator& root = nnue_stack[0];
+    nnue -> RefreshPieces(state_red, root.acc[1]);
+    nnue -> RefreshPieces(state_black, root.acc[0]);
+    root.computed = true;
+    root.num = 0;
+    NNUERefreshPool(version);
+}
+
+void board::AIBoard4::NNUERefreshPool(const int ver){
+    nnue -> RefreshPool(aidi[ver], 1, nnue_pool[ver][1]);
+    nnue -> RefreshPool(aidi[ver], 0, nnue_pool[ver][0]);
+}
+
+//side方的intchar从k个变成k-1个(add = false), 或者反过来(add = true), 只有温度计编码的第k位变了
+void board::AIBoard4::NNUEPoolFeature(const int ver, const int side, const int intchar, const int k, const bool add){
+    if(k <= 0 || k > nnue_pool_id.most[intchar]){
+        return;
+    }
+    for(int p = 0; p < 2; ++p){
+        const int feature = NNUE::PoolFeature(p == side, (char)intchar, k);
+        if(add){
+            nnue -> AddFeature(nnue_pool[ver][p], feature);
+        }else{
+            nnue -> SubFeature(nnue_pool[ver][p], feature);
+        }
+    }
+}
+
+//pos0, pos1是红方视角坐标, 0表示没有
+void board::AIBoard4::NNUEPush(unsigned char pos0, char before0, unsigned char pos1, char before1){
+    if(++nnue_top == nnue_stack.size()){
+        nnue_stack.resize(2 * nnue_stack.size());
+    }
+    NNUEAccumulator& now = nnue_stack[nnue_top];
+    now.computed = false;
+    now.num = pos1 ? 2 : 1;
+    now.pos[0] = pos0;
+    now.before[0] = before0;
+    now.after[0] = state_red[pos0];
+    now.pos[1] = pos1;
+    now.before[1] = before1;
+    now.after[1] = state_red[pos1];
+}
+
+short board::AIBoard4::NNUEEval(){
+    size_t base = nnue_top;
+    while(!nnue_stack[base].computed){
+        --base;
+    }
+    for(size_t j = base + 1; j <= nnue_top; ++j){
+        NNUEAccumulator& now = nnue_stack[j];
+        memcpy(now.acc, nnue_stack[j - 1].acc, sizeof(now.acc));
+        for(int k = 0; k < now.num; ++k){
+            const int pos = now.pos[k];
+            int feature = 0;
+            if((feature = NNUE::PieceFeature(now.before[k], pos)) >= 0){
+                nnue -> SubFeature(now.acc[1], feature);
+            }
+            if((feature = NNUE::PieceFeature(now.after[k], pos)) >= 0){
+                nnue -> AddFeature(now.acc[1], feature);
+            }
+            if((feature = NNUE::PieceFeature(swapcase(now.before[k]), 254 - pos)) >= 0){
+                nnue -> SubFeature(now.acc[0], feature);
+            }
+            if((feature = NNUE::PieceFeature(swapcase(now.after[k]), 254 - pos)) >= 0){
+                nnue -> AddFeature(now.acc[0], feature);
+            }
+        }
+        now.computed = true;
+    }
+    const NNUEAccumulator& top = nnue_stack[nnue_top];
+    const int us = turn ? 1 : 0;
+    return nnue -> Forward(top.acc[us], nnue_pool[version][us], top.acc[1 - us], nnue_pool[version][1 - us]);
+}
+
 std::string board::AIBoard4::Kaiju(){
     if(turn){
         #if DEBUG
         return _thinker_func(this);
         #else
-        int key = rand() % 100;
+        int key = context -> Random(100);
         if(key < 20){
             return "a3a4";
         }else if(key < 40){
@@ -829,6 +999,7 @@ std::string board::AIBoard4::Kaiju(){
 }
 
 std::string board::AIBoard4::Think(){
+    ApplyOptions();
     SetScoreFunction("mtd_thinker4", 2);
     return round == 0 ? Kaiju() : _thinker_func(this);
 }
@@ -893,44 +1064,64 @@ void board::AIBoard4::print_raw_board(const char* board, const char* hint, Args.
     print_raw_board(args...);
 }
 
+//四舍五入的整数除法(远离0), 和::round一致
+static inline int div_round(int num, int den){
+    return num >= 0 ? (2 * num + den) / (2 * den) : -((-2 * num + den) / (2 * den));
+}
+
+void board::AIBoard4::PrepareScoreContext(const char* state_pointer){
+    ScoreContext& ctx = score_context;
+    const int t = turn ? 1 : 0;
+    const int che_char = turn ? (int)'R': (int)'r';
+    const int che_opponent_char = che_char ^ 32;
+    const int zu_char = turn ? (int)'P': (int)'p';
+    const int sumall = aisumall[version][t], sumall_opponent = aisumall[version][1 - t];
+    ctx.version = version;
+    ctx.turn = t;
+    ctx.average = aiaverage[version][t][0][AVERAGE_SLOT];
+    ctx.average_opponent = aiaverage[version][1 - t][0][AVERAGE_SLOT];
+    ctx.scorediff = sumall > 0 ? ctx.average * ((aidi[version][t][che_char] + aidi[version][t][zu_char]) / sumall) : 0;
+    ctx.zu_bonus = sumall > 0 ? div_round(aidi[version][t][zu_char] * ctx.average, 2 * sumall) : 0;
+    //factor * (possible_che_opponent / 2 + che_opponent - (q == 'R')), possible_che_opponent = covered_opponent * 暗车数 / 暗子数
+    const int factor_penalty = score_rough < -150 ? 45 : 30;
+    const int possible_che_opponent = sumall_opponent > 0 ? \
+        div_round((factor_penalty * covered_opponent * aidi[version][1 - t][che_opponent_char]) << SCORE_FIXED_SHIFT, 2 * sumall_opponent) : 0;
+    ctx.dark_che_penalty[0] = possible_che_opponent + ((factor_penalty * che_opponent) << SCORE_FIXED_SHIFT);
+    ctx.dark_che_penalty[1] = ctx.dark_che_penalty[0] - (factor_penalty << SCORE_FIXED_SHIFT);
+    const int factor_capture = score_rough > 150 ? 45 : 30;
+    const int possible_che = sumall > 0 ? \
+        div_round((factor_capture * covered * aidi[version][t][che_char]) << SCORE_FIXED_SHIFT, 2 * sumall) : 0;
+    ctx.dark_che_capture = possible_che + ((factor_capture * che) << SCORE_FIXED_SHIFT);
+    const bool rook_mid = state_pointer[71] != 'a' && (state_pointer[71] == 'p' || state_pointer[87] != 'n');
+    ctx.rook_bonus_left = rook_mid && state_pointer[51] != 'd' && state_pointer[51] != 'r' && state_pointer[54] != 'a';
+    ctx.rook_bonus_right = rook_mid && state_pointer[59] != 'd' && state_pointer[59] != 'r' && state_pointer[56] != 'a';
+}
+
 inline short complicated_score_function4(board::AIBoard4* self, const char* state_pointer, unsigned char src, unsigned char dst){
     #define LOWER_BOUND -32768
     #define UPPER_BOUND 32767
     constexpr short MATE_UPPER = 2600;
     board::AIBoard4* bp = reinterpret_cast<board::AIBoard4*>(self);
-    int version = bp -> version;
-    int turn = bp -> turn ? 1 : 0;
-    int che_char = bp -> turn ? (int)'R': (int)'r';
-    int che_opponent_char = che_char ^ 32;
-    int zu_char = bp -> turn ? (int)'P': (int)'p';
+    const board::AIBoard4::ScoreContext& ctx = bp -> score_context;
+    const int version = ctx.version;
+    const int turn = ctx.turn;
     char p = state_pointer[src], q = bp -> swapcase(state_pointer[dst]);
     int intp = (int)p, intq = (int)q;
-    float score = 0.0;
-    float possible_che = 0.0;
-    if(bp -> aisumall[version][turn]){
-        possible_che = (float)((bp -> covered) * bp -> aidi[version][turn][che_char])/bp -> aisumall[version][turn];
-    }
-    float zu_possibility = 0.0;
-    if(bp -> aisumall[version][turn]){
-        zu_possibility = (float)(bp -> aidi[version][turn][zu_char])/bp -> aisumall[version][turn];
-    }
-    float possible_che_opponent = 0.0;
-    if(bp -> aisumall[version][1 - turn]){
-        possible_che_opponent = (float)((bp -> covered_opponent) * bp -> aidi[version][1 - turn][che_opponent_char])/bp -> aisumall[version][1 - turn];
-    }
+    int score = 0; //整数部分
+    int score_fixed = 0; //小数部分, 定点数
     if(q == 'K'){
         return MATE_UPPER;
     }
     if(p == 'R' || p == 'N' || p == 'B' || p == 'A' || p == 'K' || p == 'C' || p == 'P'){
-        score =  bp -> pst[intp][dst] -  bp -> pst[intp][src];
+        score =  bp -> pst[PID(intp)][SQ(dst)] -  bp -> pst[PID(intp)][SQ(src)];
         
         if(p == 'R'){
-            if(state_pointer[51] != 'd' && state_pointer[51] != 'r' && state_pointer[54] != 'a' && state_pointer[71] != 'a' && (state_pointer[71] == 'p' || state_pointer[87] != 'n')){
+            if(ctx.rook_bonus_left){
                 if( (dst & 15) == 6 && (src & 15) != 6 ) { score += 30; }
                 else if((src & 15) == 6 && (dst & 15) != 6) { score -= 30; }
             }
             
-            if(state_pointer[59] != 'd' && state_pointer[59] != 'r' && state_pointer[56] != 'a' && state_pointer[71] != 'a' && (state_pointer[71] == 'p' || state_pointer[87] != 'n')){
+            if(ctx.rook_bonus_right){
                 if( (dst & 15) == 8 && (src & 15) != 8 ) { score += 30; }
                 else if((src & 15) == 8 && (dst & 15) != 8) { score -= 30; }
             }
@@ -939,15 +1130,10 @@ inline short complicated_score_function4(board::AIBoard4* self, const char* stat
     }
     
     else{
-        score = bp -> aiaverage[version][turn][1][dst] - bp -> aiaverage[version][turn][0][0];
-        float che_zu_possibility = bp -> aisumall[version][turn] > 0 ? (bp -> aidi[version][turn][che_char] + bp -> aidi[version][turn][zu_char])/bp -> aisumall[version][turn] : 0.0;
-        float scorediff = bp -> aiaverage[version][turn][0][0] * che_zu_possibility;
+        score = bp -> aiaverage[version][turn][1][SQ(dst)] - ctx.average;
+        const short scorediff = ctx.scorediff;
         if(p == 'D'){
-            if(bp -> score_rough < -150){
-                score -= (45 * (possible_che_opponent/2 + bp -> che_opponent - (q == 'R')));
-            }else{
-                score -= (30 * (possible_che_opponent/2 + bp -> che_opponent - (q == 'R')));
-            }
+            score_fixed -= ctx.dark_che_penalty[q == 'R'];
         }else if(p == 'E'){
             auto judge_left = [&state_pointer]() -> bool {
                 return state_pointer[147] == 'r' || state_pointer[148] == 'r';
@@ -1031,7 +1217,7 @@ inline short complicated_score_function4(board::AIBoard4* self, const char* stat
         }else if(p == 'H'){
 
             if(src == 164 && dst == 68 && state_pointer[52] == 'e'){
-                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][0]/2);
+                short bonus = ctx.zu_bonus;
                 score += bonus/2;
                 if(state_pointer[53] != '.'){ //python BUG
                     score += bonus;
@@ -1042,7 +1228,7 @@ inline short complicated_score_function4(board::AIBoard4* self, const char* stat
             }
             
             if(src == 170 && dst == 74 && state_pointer[58] == 'e'){
-                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][0]/2);
+                short bonus = ctx.zu_bonus;
                 score += bonus/2;
                 if(state_pointer[57] != '.'){ //python BUG
                     score += bonus;
@@ -1072,26 +1258,24 @@ inline short complicated_score_function4(board::AIBoard4* self, const char* stat
     if(q >= 'A' && q <= 'Z'){
         int k = 254 - dst;
         if(q == 'R' || q == 'N' || q == 'B' || q == 'A' || q == 'C' || q == 'P'){
-            score +=  bp -> pst[intq][k];
+            score +=  bp -> pst[PID(intq)][SQ(k)];
         }
         else{
             if(q != 'U'){
-                score += bp -> aiaverage[version][1 - turn][0][0];              
+                score += ctx.average_opponent;
             }else{
-                score += bp -> aiaverage[version][1 - turn][1][k];
+                score += bp -> aiaverage[version][1 - turn][1][SQ(k)];
             }
             if(q == 'D'){
-                if(bp -> score_rough > 150){
-                    score +=  45 * (possible_che/2 + bp -> che);
-                }else{
-                    score +=  30 * (possible_che/2 + bp -> che);
-                }                   
+                score_fixed += ctx.dark_che_capture;
             }//if(q == 'D')
         }           
     }//capture
+    score_fixed += score << SCORE_FIXED_SHIFT;
+    score = div_round(score_fixed, 1 << SCORE_FIXED_SHIFT);
     if(score < LOWER_BOUND) return LOWER_BOUND;
     else if(score > UPPER_BOUND) return UPPER_BOUND;
-    return (short)round(score);
+    return (short)score;
 }
 
 inline void complicated_kongtoupao_score_function4(board::AIBoard4* bp, short* kongtoupao_score, short* kongtoupao_score_opponent){
@@ -1149,16 +1333,17 @@ std::string mtd_thinker4(board::AIBoard4* bp){
     bool execute = false;
     bp -> Scan();
     bool traverse_all_strategy = true;
-    int max_depth = (bp -> round < 15?6:7);
+    int max_depth = bp -> limits.MaxDepth(bp -> round < 15?6:7);
     int quiesc_depth = (bp -> round < 15?1:0);
     int depth = 0;
     auto start = std::chrono::high_resolution_clock::now();
-    for(depth = 6; depth <= max_depth; ++depth){
+    for(depth = bp -> limits.MinDepth(6, max_depth); depth <= max_depth; ++depth){
         short lower = -MATE_UPPER, upper = MATE_UPPER;
         int me = 0, op = 0;
         while(lower < upper - EVAL_ROBUSTNESS){
             short gamma = (lower + upper + 1)/2; //不会溢出
             short score = mtd_alphabeta4(bp, gamma, depth + quiesc_depth, true, true, true, quiesc_depth, traverse_all_strategy, &me, &op);
+            bp -> search_score = score;
             if(me <= depth + quiesc_depth + 2 || op <= depth + quiesc_depth + 2){
                 execute = true;
                 break;
@@ -1167,13 +1352,14 @@ std::string mtd_thinker4(board::AIBoard4* bp){
             if(score < gamma) { upper = score; }
         }
         if(!execute){
+            bp -> search_score = lower;
             mtd_alphabeta4(bp, lower, depth + quiesc_depth, true, true, true, quiesc_depth, traverse_all_strategy, &me, &op);
             if(me <= depth + quiesc_depth + 2 || op <= depth + quiesc_depth + 2){
                 execute = true;
             }
         }
         size_t int_ms = (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
-        if(execute || int_ms > 50000 || depth == max_depth){
+        if(execute || bp -> limits.Stop(depth, max_depth, bp -> search_nodes, int_ms)){
             bp -> Scan();
             if(me <= 6 && (bp -> covered > 0 || bp -> covered_opponent > 0)){
                 short lower = -MATE_UPPER, upper = MATE_UPPER;
@@ -1184,8 +1370,11 @@ std::string mtd_thinker4(board::AIBoard4* bp){
                     if(score < gamma) { upper = score; }
                 }
                 calleval4(bp, lower, {2, 3}, {true, false}, true, false);
+                bp -> search_score = lower;
             }
+            bp -> search_depth = depth + quiesc_depth;
             auto move = (*bp -> tp_move)[{bp -> zobrist_hash, bp -> turn}];
+            const double eval_cache_hit_rate = bp -> eval_cache_probes ? 100.0 * bp -> eval_cache_hits / bp -> eval_cache_probes : 0.0;
             if(move == std::pair<unsigned char, unsigned char>({0, 0})){
                 unsigned char mate_src = 0, mate_dst = 0;
                 std::tuple<short, unsigned char, unsigned char> legal_moves_tmp[MAX_POSSIBLE_MOVES];
@@ -1193,12 +1382,12 @@ std::string mtd_thinker4(board::AIBoard4* bp){
                 bool killer_is_alive = false;
                 short killer_score = 0;
                 bp -> GenMovesWithScore<true, false>(legal_moves_tmp, num_of_legal_moves_tmp, NULL, killer_score, mate_src, mate_dst, killer_is_alive);
-                std::cout << "My name: " << bp -> GetName() <<" [AM I FAILED?]" << num_of_legal_moves_tmp << " My move: " << bp -> translate_ucci(std::get<1>(legal_moves_tmp[0]), std::get<2>(legal_moves_tmp[0])) << ", duration = " << int_ms << ", depth = " << depth + quiesc_depth << "." << std::endl;
+                std::cout << "My name: " << bp -> GetName() <<" [AM I FAILED?]" << num_of_legal_moves_tmp << " My move: " << bp -> translate_ucci(std::get<1>(legal_moves_tmp[0]), std::get<2>(legal_moves_tmp[0])) << ", duration = " << int_ms << ", depth = " << depth + quiesc_depth << ", nodes = " << bp -> search_nodes << ", eval cache hit = " << eval_cache_hit_rate << "%." << std::endl;
                 if(num_of_legal_moves_tmp != 0){
                     return bp -> translate_ucci(std::get<1>(legal_moves_tmp[0]), std::get<2>(legal_moves_tmp[0]));
                 }
             }
-            std::cout << "My name: " << bp -> GetName()  << " My move: " << bp -> translate_ucci(move.first, move.second) << ", duration = " << int_ms << ", depth = " << depth + quiesc_depth << "." << std::endl;
+            std::cout << "My name: " << bp -> GetName()  << " My move: " << bp -> translate_ucci(move.first, move.second) << ", duration = " << int_ms << ", depth = " << depth + quiesc_depth << ", nodes = " << bp -> search_nodes << ", eval cache hit = " << eval_cache_hit_rate << "%." << std::endl;
             return bp -> translate_ucci(move.first, move.second);
         }
     }
@@ -1206,6 +1395,8 @@ std::string mtd_thinker4(board::AIBoard4* bp){
 }
 
 short mtd_quiescence4(board::AIBoard4* self, const short gamma, int quiesc_depth, const bool root, int* me, int* op){
+    ++self -> search_nodes;
+    ++self -> search_qnodes;
     constexpr short MATE_UPPER = 2600;
     constexpr int TOPK = 3;
     unsigned char mate_src = 0, mate_dst = 0;
@@ -1236,10 +1427,19 @@ short mtd_quiescence4(board::AIBoard4* self, const short gamma, int quiesc_depth
     }
     if(quiesc_depth == 0) { 
         *op = std::numeric_limits<int>::max()/2;
-        return evaluate();
+        if(self -> nnue){
+            return self -> NNUEEval();
+        }
+        if(mate){
+            //Executed里走过子, Scan的结果已经不是当前局面的了, 不进缓存
+            return evaluate();
+        }
+        return self -> score + self -> CachedEval(false);
     }
     std::pair<short, short> entry(-MATE_UPPER, MATE_UPPER);
+    ++self -> tt_probes;
     if(self -> tp_score -> find(pair) != self -> tp_score -> end()){
+        ++self -> tt_hits;
         entry = (*self -> tp_score)[pair];
     }
     if(entry.first >= gamma){
@@ -1290,8 +1490,7 @@ short mtd_quiescence4(board::AIBoard4* self, const short gamma, int quiesc_depth
         }
     }
     if(!into) {
-        self -> Scan();
-        return evaluate();
+        return self -> nnue ? self -> NNUEEval() : self -> score + self -> CachedEval(true);
     }
     if(best >= gamma){
         (*self -> tp_score)[pair] = {best, entry.second};
@@ -1308,6 +1507,7 @@ short mtd_quiescence4(board::AIBoard4* self, const short gamma, int quiesc_depth
 }
 
 short mtd_alphabeta4(board::AIBoard4* self, const short gamma, int depth, const bool root, const bool nullmove, const bool nullmove_now, const int quiesc_depth, const bool traverse_all_strategy, int* me, int* op){
+    ++self -> search_nodes;
     constexpr short MATE_UPPER = 2600;
     unsigned char mate_src = 0, mate_dst = 0;
     *me = std::numeric_limits<int>::max()/2;
@@ -1354,7 +1554,9 @@ short mtd_alphabeta4(board::AIBoard4* self, const short gamma, int depth, const
         return score;
     }
     std::pair<short, short> entry(-MATE_UPPER, MATE_UPPER);
+    ++self -> tt_probes;
     if(self -> tp_score -> find(pair) != self -> tp_score -> end()){
+        ++self -> tt_hits;
         entry = (*self -> tp_score)[pair];
     }
     if(entry.first >= gamma && (!root || killer_is_alive)){
@@ -1502,7 +1704,9 @@ short mtd_alphabeta_doublerecursive4(board::AIBoard4* self, const int ver, const
     }
     std::pair<short, short> entry(-MATE_UPPER, MATE_UPPER);
     std::pair<uint32_t, int> pair = {self -> zobrist_hash, (depth << 1) + (int)self -> turn};
+    ++self -> tt_probes;
     if(self -> tp_score -> find(pair) != self -> tp_score -> end()){
+        ++self -> tt_hits;
         entry = (*self -> tp_score)[pair];
     }
     if(entry.first >= gamma && (!root || killer_is_alive)){
@@ -1585,7 +1789,6 @@ void _inner_recur(board::AIBoard4* self, const int ver, std::unordered_map<unsig
     }
     if((size_t)index >= uncertainty_keys.size()){
         self -> score = score;
-        self -> CalcVersion(ver, discount_factor);
         short res =  mtd_alphabeta_doublerecursive4(self, ver, gamma, depths, traverse_all_strategies, true, nullmove, nullmove_now, pruning, discount_factor, uncertainty_dict, &need_clamp);
         result_dict[{me, op}] += ((need_clamp && res >= THRES) ? THRES : res);
         counter_dict[{me, op}] += 1;
@@ -1600,20 +1803,26 @@ void _inner_recur(board::AIBoard4* self, const int ver, std::unordered_map<unsig
                 for(char c : MINGZI){
                     int intchar = turn ? (int)c : ((int)c) ^ 32;
                     if(self -> aidi[ver][turn][intchar] > 0){
-                        --self -> aidi[ver][turn][intchar];
+                        self -> RemoveFromPool(ver, turn, intchar, discount_factor);
                         uint32_t zobrist_before = self -> zobrist_hash;
                         int zobrist_key = turn ? key : 254 - key;
-                        self -> zobrist_hash ^= self -> zobrist[(int)self -> state_red[zobrist_key]][zobrist_key];
+                        self -> zobrist_hash ^= self -> zobrist[SID(self -> state_red[zobrist_key])][SQ(zobrist_key)];
                         state_pointer[key] = c;
                         state_pointer_oppo[254 - key] = self -> swapcase(c);
-                        self -> zobrist_hash ^= self -> zobrist[(int)self -> state_red[zobrist_key]][zobrist_key];
-                        short score_diff = self -> pst[(int)c][key] - self -> aiaverage[ver-1][turn][1][key];
+                        self -> zobrist_hash ^= self -> zobrist[SID(self -> state_red[zobrist_key])][SQ(zobrist_key)];
+                        if(self -> nnue){
+                            self -> NNUEPush(zobrist_key, turn ? 'U' : 'u');
+                        }
+                        short score_diff = self -> pst[PID(c)][SQ(key)] - self -> aiaverage[ver-1][turn][1][SQ(key)];
                         _inner_recur(self, ver, uncertainty_dict, uncertainty_keys, result_dict, counter_dict, index+1, me*(self -> aidi[ver][turn][intchar] + 1), op, pruning, score + score_diff/2, gamma, depths, \
                             traverse_all_strategies, nullmove, nullmove_now, discount_factor);
                         state_pointer[key] = 'U';
                         state_pointer_oppo[254 - key] = 'u';
                         self -> zobrist_hash = zobrist_before;
-                        ++self -> aidi[ver][turn][intchar];
+                        if(self -> nnue){
+                            self -> NNUEPop();
+                        }
+                        self -> ReturnToPool();
                     }
                 }
                 break;
@@ -1623,20 +1832,26 @@ void _inner_recur(board::AIBoard4* self, const int ver, std::unordered_map<unsig
                 for(char c: MINGZI){
                     int intchar = notturn ? (int)c : ((int)c) ^ 32;
                     if(self -> aidi[ver][notturn][intchar] > 0){
-                        --self -> aidi[ver][notturn][intchar];
+                        self -> RemoveFromPool(ver, notturn, intchar, discount_factor);
                         uint32_t zobrist_before = self -> zobrist_hash;
                         int zobrist_key = turn ? key : 254 - key;
-                        self -> zobrist_hash ^= self -> zobrist[(int)self -> state_red[zobrist_key]][zobrist_key];
+                        self -> zobrist_hash ^= self -> zobrist[SID(self -> state_red[zobrist_key])][SQ(zobrist_key)];
                         state_pointer[key] = self -> swapcase(c);
                         state_pointer_oppo[254 - key] = c;
-                        self -> zobrist_hash ^= self -> zobrist[(int)self -> state_red[zobrist_key]][zobrist_key];
-                        short score_diff = self -> pst[(int)c][254 - key] - self -> aiaverage[ver-1][notturn][1][254 - key];
+                        self -> zobrist_hash ^= self -> zobrist[SID(self -> state_red[zobrist_key])][SQ(zobrist_key)];
+                        if(self -> nnue){
+                            self -> NNUEPush(zobrist_key, turn ? 'u' : 'U');
+                        }
+                        short score_diff = self -> pst[PID(c)][SQ(254 - key)] - self -> aiaverage[ver-1][notturn][1][SQ(254 - key)];
                         _inner_recur(self, ver, uncertainty_dict, uncertainty_keys, result_dict, counter_dict, index+1, me, op*(self -> aidi[ver][notturn][intchar] + 1), pruning, score-score_diff/2, gamma, depths, \
                             traverse_all_strategies, nullmove, nullmove_now, discount_factor);
                         state_pointer[key] = 'u';
                         state_pointer_oppo[254 - key] = 'U';
                         self -> zobrist_hash = zobrist_before;
-                        ++self -> aidi[ver][notturn][intchar];
+                        if(self -> nnue){
+                            self -> NNUEPop();
+                        }
+                        self -> ReturnToPool();
                     }
                 }
                 break;
@@ -1648,6 +1863,7 @@ void _inner_recur(board::AIBoard4* self, const int ver, std::unordered_map<unsig
 
 short eval4(board::AIBoard4* self, const int ver, const short gamma, std::vector<int>& depths, std::vector<bool>& traverse_all_strategies, const bool nullmove, const bool nullmove_now, const bool pruning, \
     const float discount_factor){
+    ++self -> eval_calls;
     self -> original_turns[ver] = self -> turn;
     std::unordered_map<unsigned char, char> uncertainty_dict;
     std::vector<unsigned char> uncertainty_keys;
@@ -1667,6 +1883,10 @@ short eval4(board::AIBoard4* self, const int ver, const short gamma, std::vector
 
     else{
         memcpy(self -> aidi[ver], self -> aidi[ver-1], sizeof(self -> aidi[ver]));
+        self -> CalcVersion(ver, discount_factor); //没有暗子时mtd_alphabeta_doublerecursive4也要用这一层的均值
+        if(self -> nnue){
+            self -> NNUERefreshPool(ver);
+        }
         for(unsigned char i = 51; i <= 203; ++i){
             if((i & 15) < 3 || (i & 15) > 11) { continue; }
             if(state_pointer[i] == 'U' || state_pointer[i] == 'u'){
@@ -1693,3 +1913,69 @@ short calleval4(board::AIBoard4* self, const short gamma, std::vector<int> depth
     memset(self -> original_turns, self -> turn, sizeof(self -> original_turns));
     return eval4(self, 0, gamma, depths, traverse_all_strategies, nullmove, nullmove, pruning, self -> discount_factor);
 }
+
+//带分数的走法生成的吞吐量, checksum用来核对打分函数改写前后的结果是否一致
+static void _bench_movegen4(board::AIBoard4* bp, int depth, long long& nodes, long long& moves, uint64_t& checksum){
+    std::tuple<short, unsigned char, unsigned char> legal_moves[MAX_POSSIBLE_MOVES];
+    int num_of_legal_moves = 0;
+    short killer_score = 0;
+    unsigned char mate_src = 0, mate_dst = 0;
+    bool killer_is_alive = false;
+    bp -> Scan();
+    bp -> GenMovesWithScore<true, false>(legal_moves, num_of_legal_moves, NULL, killer_score, mate_src, mate_dst, killer_is_alive);
+    ++nodes;
+    moves += num_of_legal_moves;
+    for(int i = 0; i < num_of_legal_moves; ++i){
+        checksum = checksum * 1000003 + (uint16_t)std::get<0>(legal_moves[i]) * 65536 + std::get<1>(legal_moves[i]) * 256 + std::get<2>(legal_moves[i]);
+    }
+    if(depth <= 1){
+        return;
+    }
+    for(int i = 0; i < num_of_legal_moves; ++i){
+        const unsigned char src = std::get<1>(legal_moves[i]), dst = std::get<2>(legal_moves[i]);
+        if(bp -> getstatepointer()[dst] == 'k'){
+            continue;
+        }
+        bp -> Move(src, dst, std::get<0>(legal_moves[i]));
+        _bench_movegen4(bp, depth - 1, nodes, moves, checksum);
+        bp -> UndoMove(1);
+    }
+}
+
+void bench_movegen4(const char another_state[MAX], const unsigned char di[VERSION_MAX][2][123], int depth){
+    std::unordered_map<std::string, bool> hist;
+    board::AIBoard4 ai(another_state, true, 0, di, 0, &hist);
+    long long nodes = 0, moves = 0;
+    uint64_t checksum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    _bench_movegen4(&ai, depth, nodes, moves, checksum);
+    size_t int_ms = (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    printf("movegen4: depth = %d, nodes = %lld, moves = %lld, duration = %zu ms, moves/s = %.0f, checksum = %016llx\n", \
+        depth, nodes, moves, int_ms, moves * 1000.0 / (int_ms ? int_ms : 1), (unsigned long long)checksum);
+}
+
+std::vector<std::string> scored_moves4(const char another_state[MAX], bool turn, const unsigned char di[VERSION_MAX][2][123], EngineContext* context, bool* mate){
+    std::unordered_map<std::string, bool> hist;
+    board::AIBoard4 ai(another_state, turn, 1, di, 0, &hist, context);
+    std::tuple<short, unsigned char, unsigned char> legal_moves[MAX_POSSIBLE_MOVES];
+    int num_of_legal_moves = 0;
+    short killer_score = 0;
+    unsigned char mate_src = 0, mate_dst = 0;
+    bool killer_is_alive = false;
+    ai.Scan();
+    *mate = ai.GenMovesWithScore<true, false>(legal_moves, num_of_legal_moves, NULL, killer_score, mate_src, mate_dst, killer_is_alive);
+    std::vector<std::string> ret;
+    for(int i = 0; i < num_of_legal_moves; ++i){
+        const unsigned char src = std::get<1>(legal_moves[i]), dst = std::get<2>(legal_moves[i]);
+        if(ai.getstatepointer()[dst] == 'k'){
+            continue;
+        }
+        ai.Move(src, dst, std::get<0>(legal_moves[i]));
+        const bool suicide = ai.Mate<false>(); //走完被对方吃帅
+        ai.UndoMove(1);
+        if(!suicide){
+            ret.push_back(ai.translate_ucci(src, dst));
+        }
+    }
+    return ret;
+}
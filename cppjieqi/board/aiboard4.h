@@ -17,7 +17,6 @@
 #define SOUTH 16
 #define WEST -1
 #define GS(x) std::get<0>(x)
-extern unsigned char L1[256][256];
 #include <cstddef>
 #include <vector>
 #include <string>
@@ -43,13 +42,14 @@ extern unsigned char L1[256][256];
 #include <functional>
 #include "../global/global.h"
 #include "../score/score.h"
+#include "../score/nnue.h"
 #include "thinker.h"
 #define ROOTED 0
 #define CLEAR_EVERY_DEPTH false
 #define CH(X) self->C(X)
+#define SCORE_FIXED_SHIFT 10
+#define NNUE_BEAN -4 //用NNUE的AIBoard4单独一套置换表, 不和手写评估的AIBoard4混用
 
-extern std::unordered_map<int, std::unordered_map<std::pair<uint32_t, bool>, std::pair<unsigned char, unsigned char>, myhash<uint32_t, bool>>> tp_move_bean;
-extern std::unordered_map<int, std::unordered_map<std::pair<uint32_t, int>, std::pair<short, short>, myhash<uint32_t, int>>> tp_score_bean;
 namespace board{
     class AIBoard4;
 }
@@ -59,18 +59,27 @@ typedef void(*KONGTOUPAO_SCORE4)(board::AIBoard4* bp, short* kongtoupao_score, s
 typedef std::string(*THINKER4)(board::AIBoard4* bp);
 void register_score_functions4();
 std::string SearchScoreFunction4(void* score_func, int type);
-extern short pstglobal[5][123][256];
+extern unsigned char L1[SQUARE_SLOTS][SQUARE_SLOTS];
 template <typename K, typename V>
 extern V GetWithDefUnordered(const std::unordered_map<K,V>& m, const K& key, const V& defval);
-extern void copy_pst(short dst[][256], short src[][256]);
 
 
 namespace board{
 class AIBoard4 : public Thinker{
 public:
-    short aiaverage[VERSION_MAX][2][2][256];
+    short aiaverage[VERSION_MAX][2][2][SQUARE_SLOTS];
     unsigned char aisumall[VERSION_MAX][2];
     unsigned char aidi[VERSION_MAX][2][123];
+    int aisum[VERSION_MAX][2][SQUARE_NUM]; //sum(pst * aidi), 暗子池变化时增量更新
+    //RemoveFromPool拿走的是哪个子, 以及拿走之前这一方的均值; ReturnToPool把pst加回aisum, 均值直接拷回去, 不用再除一遍
+    struct AverageDelta{
+        int ver;
+        int side;
+        int intchar;
+        short average_slot; //aiaverage[ver][0][0][AVERAGE_SLOT]
+        short average[SQUARE_NUM]; //aiaverage[ver][side][1]
+    };
+    std::vector<AverageDelta> average_deltas;
     bool lastinsert = false;
     int version = 0;
     int round = 0;
@@ -98,7 +107,7 @@ public:
     char state_black[MAX];
     std::stack<std::tuple<unsigned char, unsigned char, char>> cache;
     short score;//局面分数
-    short pst[123][256];
+    const short (*pst)[SQUARE_SLOTS]; //指向context -> pst, 只读
     std::stack<short> score_cache;
     std::unordered_set<uint32_t> zobrist_cache;
     std::set<unsigned char> rooted_chesses;
@@ -106,10 +115,43 @@ public:
     std::unordered_map<std::pair<uint32_t, bool>, std::pair<unsigned char, unsigned char>, myhash<uint32_t, bool>>* tp_move;
     //tp_score: (zobrist_key, turn, depth <depth * 2 + turn>) --> (lower, upper)
     std::unordered_map<std::pair<uint32_t, int>, std::pair<short, short>, myhash<uint32_t, int>>* tp_score;
+    //eval_cache: (zobrist_key, turn) --> 静态评估里和走子路径无关的部分
+    EvalCache* eval_cache;
+    uint64_t eval_cache_probes = 0;
+    uint64_t eval_cache_hits = 0;
+    //NNUE评估, NULL表示用手写评估; 由players.conf里的playerX.eval=nnue打开
+    const NNUE* nnue = NULL;
+    //每层一个累加器, Move时只记下变化的格子, 评估时才从最近算好的一层往上补
+    struct NNUEAccumulator{
+        alignas(32) int16_t acc[2][NNUE::HIDDEN]; //[1]红方视角(state_red), [0]黑方视角(state_black)
+        bool computed;
+        int num; //和上一层相比变了几个格子
+        unsigned char pos[2]; //红方视角坐标
+        char before[2]; //state_red里原来的子
+        char after[2]; //state_red里现在的子
+    };
+    std::vector<NNUEAccumulator> nnue_stack;
+    size_t nnue_top = 0;
+    alignas(32) int16_t nnue_pool[VERSION_MAX][2][NNUE::HIDDEN]; //暗子池特征的累加器, 暗子池变化时增量更新
     std::unordered_map<std::string, bool>* hist;
     std::unordered_map<std::string, std::pair<unsigned char, unsigned char>> kaijuku;
+    //complicated_score_function4里只和节点有关、和走法无关的量, 每次生成走法前算一次
+    //带小数的量用定点数表示, 单位是1/(1 << SCORE_FIXED_SHIFT)
+    struct ScoreContext{
+        int version;
+        int turn;
+        short average; //己方暗子均值
+        short average_opponent; //对方暗子均值
+        short scorediff; //average * che_zu_possibility(整数除法, 和原来一致)
+        short zu_bonus; //round(zu_possibility * average / 2)
+        int dark_che_penalty[2]; //翻暗车的惩罚, 下标是被吃的子是否为车
+        int dark_che_capture; //吃暗车的奖励
+        bool rook_bonus_left; //车占d路有奖励(看51/54/71/87)
+        bool rook_bonus_right; //车占f路有奖励(看59/56/71/87)
+    } score_context;
+    void PrepareScoreContext(const char* state_pointer);
     AIBoard4() noexcept;
-    AIBoard4(const char another_state[MAX], bool turn, int round, const unsigned char di[5][2][123], short score, std::unordered_map<std::string, bool>* hist) noexcept;
+    AIBoard4(const char another_state[MAX], bool turn, int round, const unsigned char di[5][2][123], short score, std::unordered_map<std::string, bool>* hist, EngineContext* context = NULL) noexcept;
     AIBoard4(const AIBoard4& another_board) = delete;
     virtual ~AIBoard4()=default;
     void Reset() noexcept;
@@ -122,6 +164,7 @@ public:
     void NULLMove();
     void UndoMove(int type);
     short ScanProtectors();
+    short CachedEval(bool need_scan);
     void Scan();
     void KongTouPao(const char* _state_pointer, int pos, bool t);
     template<bool needscore, bool return_after_mate> 
@@ -131,14 +174,26 @@ public:
     bool ExecutedDebugger(bool *oppo_mate);
     bool Ismate_After_Move(unsigned char src, unsigned char dst);
     void CalcVersion(const int ver, const float discount_factor);
+    void CalcAverage(const int ver, const int side, const float discount_factor);
+    void RemoveFromPool(const int ver, const int side, const int intchar, const float discount_factor);
+    void ReturnToPool();
     void CopyData(const unsigned char di[5][2][123]);
+    void ApplyOptions();
+    void NNUERefresh();
+    void NNUERefreshPool(const int ver);
+    void NNUEPoolFeature(const int ver, const int side, const int intchar, const int k, const bool add);
+    void NNUEPush(unsigned char pos0, char before0, unsigned char pos1 = 0, char before1 = 0);
+    void NNUEPop(){
+        --nnue_top;
+    }
+    short NNUEEval();
     std::string Kaiju();
     virtual std::string Think();
     void PrintPos(bool turn) const;
     std::string DebugPrintPos(bool turn) const;
     void print_raw_board(const char* board, const char* hint);
     template<typename... Args> void print_raw_board(const char* board, const char* hint, Args... args);
-    uint32_t zobrist[123][256];
+    const uint32_t (*zobrist)[SQUARE_SLOTS]; //指向context -> zobrist, 只读
     #if DEBUG
     std::vector<std::string> debug_flags;
     int movecounter=0;
@@ -147,7 +202,7 @@ public:
         uint32_t theoretical_hash = 0;
         for(int j = 51; j <= 203; ++j){
             if(::isalpha(state_red[j])){
-                 theoretical_hash ^= zobrist[(int)state_red[j]][j];
+                 theoretical_hash ^= zobrist[SID(state_red[j])][SQ(j)];
             }
         }
         return theoretical_hash;
@@ -245,22 +300,6 @@ public:
        return translate_single(std::get<1>(t)) + translate_single(std::get<2>(t));
     };
 
-    std::function<uint32_t(void)> randU32 = []() -> uint32_t{
-	   //BUG: 在Windows上每次生成同样的随机数
-	   #ifdef WIN32
-	   //Windows RAND_MAX 0x7fff
-	   int a = rand();
-	   unsigned b = ((a & 1) << 15) | a; //符号位随机
-	   int c = rand();
-	   unsigned d = ((c & 1) << 15) | c; //符号位随机
-	   return (b << 16) | d;
-	   #else
-       std::mt19937 gen(std::random_device{}());
-       uint32_t randomNumber = gen();
-       return randomNumber;
-	   #endif
-    };
-
     template<typename T>
     inline T div(T x, T y){
         if(std::is_floating_point<T>::value){
@@ -291,22 +330,15 @@ private:
         return ret;
     };
     std::function<void(void)> _initialize_zobrist = [this](){
-        for(int i = 0; i < 123; ++i){
-            for(int j = 0; j < 256; ++j){
-                if(i != '.'){
-                    zobrist[i][j] = randU32();
-				}
-                else
-                    zobrist[i][j] = 0;
-            }
-        }
+        zobrist = this -> context -> zobrist;
         for(int j = 51; j <= 203; ++j){
             if(::isalpha(state_red[j])){
-                zobrist_hash ^= zobrist[(int)state_red[j]][j];
+                zobrist_hash ^= zobrist[SID(state_red[j])][SQ(j)];
             }
         }
     };
-    void _initialize_dir();
+    static const bool _dir_initialized;
+    static void _initialize_dir();
 };
 }
 
@@ -323,6 +355,9 @@ void _inner_recur(board::AIBoard4* self, const int ver, std::unordered_map<unsig
 short eval4(board::AIBoard4* self, const int ver, const short gamma, std::vector<int>& depths, std::vector<bool>& traverse_all_strategies, const bool nullmove, const bool nullmove_now, const bool pruning, \
     const float discount_factor);
 short calleval4(board::AIBoard4* self, const short gamma, std::vector<int> depths, std::vector<bool> traverse_all_strategies, const bool nullmove, const bool pruning);
+void bench_movegen4(const char another_state[MAX], const unsigned char di[VERSION_MAX][2][123], int depth);
+//行棋方视角的局面下按走法生成的分数从高到低排好的全部着法(ucci, 黑方是黑方视角), 不含吃帅和送帅, mate返回能不能吃帅; bench用它走出测试局面
+std::vector<std::string> scored_moves4(const char another_state[MAX], bool turn, const unsigned char di[VERSION_MAX][2][123], EngineContext* context, bool* mate);
 #if DEBUG
 void debugset(board::AIBoard4* self);
 #endif
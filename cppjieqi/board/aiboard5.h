@@ -17,7 +17,6 @@
 #define SOUTH 16
 #define WEST -1
 #define GS(x) std::get<0>(x)
-extern unsigned char L1[256][256];
 
 #include <cstddef>
 #include <vector>
@@ -48,8 +47,6 @@ extern unsigned char L1[256][256];
 #define CLEAR_EVERY_DEPTH false
 #define CH(X) self->C(X)
 
-extern std::unordered_map<int, std::unordered_map<std::pair<uint32_t, bool>, std::pair<unsigned char, unsigned char>, myhash<uint32_t, bool>>> tp_move_bean;
-extern std::unordered_map<int, std::unordered_map<std::pair<uint32_t, int>, std::pair<short, short>, myhash<uint32_t, int>>> tp_score_bean;
 namespace board{
     class AIBoard5;
 }
@@ -59,16 +56,15 @@ typedef void(*KONGTOUPAO_SCORE5)(board::AIBoard5* bp, short* kongtoupao_score, s
 typedef std::string(*THINKER5)(board::AIBoard5* bp);
 void register_score_functions5();
 std::string SearchScoreFunction5(void* score_func, int type);
-extern short pstglobal[5][123][256];
+extern unsigned char L1[SQUARE_SLOTS][SQUARE_SLOTS];
 template <typename K, typename V>
 extern V GetWithDefUnordered(const std::unordered_map<K,V>& m, const K& key, const V& defval);
-extern void copy_pst(short dst[][256], short src[][256]);
 
 
 namespace board{
 class AIBoard5 : public Thinker{
 public:
-    short aiaverage[VERSION_MAX][2][2][256];
+    short aiaverage[VERSION_MAX][2][2][SQUARE_SLOTS];
     unsigned char aisumall[VERSION_MAX][2];
     unsigned char aidi[VERSION_MAX][2][123];
     bool lastinsert = false;
@@ -96,7 +92,7 @@ public:
     char state_black[MAX];
     std::stack<std::tuple<unsigned char, unsigned char, char>> cache;
     short score;//局面分数
-    short pst[123][256];
+    const short (*pst)[SQUARE_SLOTS]; //指向context -> pst, 只读
     std::stack<short> score_cache;
     std::unordered_set<uint32_t> zobrist_cache;
     std::set<unsigned char> rooted_chesses;
@@ -107,7 +103,7 @@ public:
     std::unordered_map<std::string, bool>* hist;
     std::unordered_map<std::string, std::pair<unsigned char, unsigned char>> kaijuku;
     AIBoard5() noexcept;
-    AIBoard5(const char another_state[MAX], bool turn, int round, const unsigned char di[5][2][123], short score, std::unordered_map<std::string, bool>* hist) noexcept;
+    AIBoard5(const char another_state[MAX], bool turn, int round, const unsigned char di[5][2][123], short score, std::unordered_map<std::string, bool>* hist, EngineContext* context = NULL) noexcept;
     AIBoard5(const AIBoard5& another_board) = delete;
     virtual ~AIBoard5()=default;
     void Reset() noexcept;
@@ -142,7 +138,7 @@ public:
         uint32_t theoretical_hash = 0;
         for(int j = 51; j <= 203; ++j){
             if(::isalpha(state_red[j])){
-                 theoretical_hash ^= _zobrist[(int)state_red[j]][j];
+                 theoretical_hash ^= _zobrist[SID(state_red[j])][SQ(j)];
             }
         }
         return theoretical_hash;
@@ -240,26 +236,11 @@ public:
        return translate_single(std::get<1>(t)) + translate_single(std::get<2>(t));
     };
 
-    std::function<uint32_t(void)> randU32 = []() -> uint32_t{
-	   //BUG: 在Windows上每次生成同样的随机数
-	   #ifdef WIN32
-	   //Windows RAND_MAX 0x7fff
-	   int a = rand();
-	   unsigned b = ((a & 1) << 15) | a; //符号位随机
-	   int c = rand();
-	   unsigned d = ((c & 1) << 15) | c; //符号位随机
-	   return (b << 16) | d;
-	   #else
-       std::mt19937 gen(std::random_device{}());
-       uint32_t randomNumber = gen();
-       return randomNumber;
-	   #endif
-    };
 
 private:
     const char* _kaijuku_file;
     std::string _myname;
-    uint32_t _zobrist[123][256];
+    const uint32_t (*_zobrist)[SQUARE_SLOTS]; //指向context -> zobrist, 只读
     bool _has_initialized = false;
     static const int _chess_board_size;
     static const char _initial_state[MAX];
@@ -279,22 +260,15 @@ private:
         return ret;
     };
     std::function<void(void)> _initialize_zobrist = [this](){
-        for(int i = 0; i < 123; ++i){
-            for(int j = 0; j < 256; ++j){
-                if(i != '.'){
-                    _zobrist[i][j] = randU32();
-				}
-                else
-                    _zobrist[i][j] = 0;
-            }
-        }
+        _zobrist = this -> context -> zobrist;
         for(int j = 51; j <= 203; ++j){
             if(::isalpha(state_red[j])){
-                zobrist_hash ^= _zobrist[(int)state_red[j]][j];
+                zobrist_hash ^= _zobrist[SID(state_red[j])][SQ(j)];
             }
         }
     };
-    void _initialize_dir();
+    static const bool _dir_initialized;
+    static void _initialize_dir();
 };
 }
 
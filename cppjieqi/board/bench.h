@@ -0,0 +1,25 @@
+#ifndef bench_h
+#define bench_h
+
+#include <cstdint>
+#include <stdio.h>
+#include "board.h"
+
+#define BENCH_SEED 20211017u //引擎的EngineContext(置换表、随机数)都用这个种子
+#define BENCH_DEFAULT_DEPTH 4
+
+//测试局面: FEN(格式和perft一样, 见perft.h), 暗子池按perft的规则从棋盘上算出来, 双方看到的一样
+//round是AIBoard的回合数(round为0时会查开局库, 小于15时搜索深度不一样), FEN里没有, 单独写
+//cppjieqi和cppjieqi2用同一组局面
+struct BenchPosition{
+    const char* name;
+    const char* fen;
+    int round;
+};
+
+//AI3, AI4, AI5在每个局面上搜到固定深度, 打印每个局面的节点数、到这个深度的用时、NPS, 最后打印节点数签名
+//签名只由节点数和选的着法决定: 改了代码签名不变说明搜索树没变, 只是快慢变了
+//返回签名, FEN解析不了返回0
+uint64_t RunBench(int depth);
+
+#endif
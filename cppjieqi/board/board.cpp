@@ -122,6 +122,7 @@ const std::unordered_map<std::string, std::string> board::Board::uni_pieces = {
 };
 
 char board::Board::_dir[91][8] = {{0}};
+const bool board::Board::_dir_initialized = (_initialize_dir(), true); //静态初始化时填好, 之后只读
 
 board::Board::Board() noexcept: finished(false),
                       turn(true),
@@ -140,7 +141,6 @@ board::Board::Board() noexcept: finished(false),
     #endif
     memset(_is_legal_move, false, sizeof(_is_legal_move));
     memset(legal_moves, 0, sizeof(legal_moves));
-    _initialize_dir();
     GenerateRandomMap();
     hist[state_red] = false;
     initialize_di();
@@ -166,7 +166,6 @@ void board::Board::Reset(std::unordered_map<bool, std::unordered_map<unsigned ch
     state_red[_chess_board_size] = '\0';
     state_black[_chess_board_size] = '\0';
     memset(_is_legal_move, false, sizeof(_is_legal_move));
-    _initialize_dir();
     if(random_map){
         this -> random_map = std::move(*random_map);
     }else{
@@ -544,6 +543,10 @@ void board::Board::Print_ij_ucci(unsigned char i, unsigned char j){
 }
 
 void board::Board::GenerateRandomMap(){
+    GenerateRandomMap(NULL);
+}
+
+void board::Board::GenerateRandomMap(std::mt19937* rng){
     auto pop_chess = [](std::vector<char>& v, char c){
         for(std::vector<char>::iterator it = v.begin(); it != v.end(); ){
             if(*it == c){
@@ -572,8 +575,13 @@ void board::Board::GenerateRandomMap(){
     std::vector<unsigned char> position_black = {TXY(9, 0), TXY(9, 1), TXY(9, 2), TXY(9, 3), TXY(9, 5), TXY(9, 6), \
         TXY(9, 7), TXY(9, 8), TXY(7, 1), TXY(7, 7), TXY(6, 0), TXY(6, 2), TXY(6, 4), TXY(6, 6), TXY(6, 8)};
     int size = 15;
-    SV(chararray_red); 
-    SV(chararray_black);
+    if(rng){
+        SV_SEEDED(chararray_red, *rng);
+        SV_SEEDED(chararray_black, *rng);
+    }else{
+        SV(chararray_red); 
+        SV(chararray_black);
+    }
     std::unordered_map<unsigned char, char> r, b;
     for(int i = 0, cnt = 0; i < size; ++i){
         if(state_red[position_red[i]] >= 'D' && state_red[position_red[i]] <= 'I'){
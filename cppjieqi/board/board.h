@@ -43,6 +43,8 @@
 #else
 #define SV(vector) shuffle(vector.begin(), vector.end(), std::default_random_engine(std::chrono::system_clock::now().time_since_epoch().count()))
 #endif
+//按给定的随机数发生器洗牌, 手写Fisher-Yates, 同一个种子在哪个标准库下结果都一样
+#define SV_SEEDED(vector, rng) for(size_t _k = vector.size(); _k > 1; --_k){ std::swap(vector[_k - 1], vector[(rng)() % _k]); }
 #define FIND(c, place, perspective) \
 if(c == '.'){ \
     eat_type_tmp = 0; \
@@ -84,7 +86,11 @@ public:
     std::shared_ptr<InfoDict> Move(const int x1, const int y1, const int x2, const int y2, const bool = false);
     void DebugDI();
     void GenMovesWithScore();
+    bool IsLegalMove(unsigned char src, unsigned char dst) const{ //GenMovesWithScore以后查, 行棋方视角
+        return _is_legal_move[src][dst];
+    }
     void GenerateRandomMap();
+    void GenerateRandomMap(std::mt19937* rng); //rng为NULL时和上面一样, 否则布局完全由rng决定
     void PrintRandomMap(bool turn);
     std::function<int(int)> translate_x = [](const int x) -> int {return 12 - x;};
     std::function<int(int)> translate_y = [](const int y) -> int {return 3 + y;};
@@ -147,7 +153,8 @@ private:
         c = (swapcasewhenblack && !turn)?swapcase(c):c;
         return _getstring(c);
     };
-    void _initialize_dir();
+    static const bool _dir_initialized;
+    static void _initialize_dir();
 };
 }
 
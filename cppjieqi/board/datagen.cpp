@@ -0,0 +1,152 @@
+#include "datagen.h"
+#include "god.h"
+#if defined(WIN32) || defined(_WIN32)
+#define DATAGEN_FORK 0
+#else
+#define DATAGEN_FORK 1
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+DataWriter::DataWriter(const std::string& prefix, int worker): _prefix(prefix), _worker(worker){
+    _buffer.reserve(DATA_BUFFER_RECORDS);
+    //跳过已经写满的chunk, 接着写第一个没满的
+    while(true){
+        std::ifstream in(_chunk_name(_chunk), std::ios::binary | std::ios::ate);
+        if(!in.is_open()){
+            break;
+        }
+        const size_t bytes = (size_t)in.tellg();
+        if(bytes % sizeof(DataRecord) != 0){
+            //上次写到一半被杀掉了, 不往坏文件后面接
+            printf("%s has a partial record, skip it\n", _chunk_name(_chunk).c_str());
+            ++_chunk;
+            continue;
+        }
+        if(bytes / sizeof(DataRecord) < DATA_RECORDS_PER_CHUNK){
+            _in_chunk = bytes / sizeof(DataRecord);
+            break;
+        }
+        ++_chunk;
+    }
+    _ok = _open_chunk();
+}
+
+DataWriter::~DataWriter(){
+    Flush();
+    if(_file){
+        fclose(_file);
+    }
+}
+
+std::string DataWriter::_chunk_name(size_t chunk) const{
+    return _prefix + "." + std::to_string(_worker) + "." + std::to_string(chunk) + ".bin";
+}
+
+bool DataWriter::_open_chunk(){
+    if(_file){
+        fclose(_file);
+    }
+    _file = fopen(_chunk_name(_chunk).c_str(), "ab");
+    if(!_file){
+        printf("[FAILED 0]board --> datagen.cpp --> Open %s FAILED!\n", _chunk_name(_chunk).c_str());
+        return false;
+    }
+    return true;
+}
+
+void DataWriter::Append(const DataRecord* records, size_t num){
+    _buffer.insert(_buffer.end(), records, records + num);
+    if(_buffer.size() >= DATA_BUFFER_RECORDS){
+        Flush();
+    }
+}
+
+void DataWriter::Flush(){
+    size_t done = 0;
+    while(_ok && done < _buffer.size()){
+        const size_t num = std::min(_buffer.size() - done, DATA_RECORDS_PER_CHUNK - _in_chunk);
+        if(fwrite(_buffer.data() + done, sizeof(DataRecord), num, _file) != num){
+            printf("[FAILED 1]board --> datagen.cpp --> Write %s FAILED!\n", _chunk_name(_chunk).c_str());
+            _ok = false;
+            break;
+        }
+        done += num;
+        written += num;
+        _in_chunk += num;
+        if(_in_chunk == DATA_RECORDS_PER_CHUNK){
+            ++_chunk;
+            _in_chunk = 0;
+            _ok = _open_chunk();
+        }
+    }
+    if(_file){
+        fflush(_file);
+    }
+    _buffer.clear();
+}
+
+static int _run_worker(const char* players_file, size_t games, int worker, const std::string& prefix){
+    const std::string name = prefix + "." + std::to_string(worker);
+    srand(time(NULL) + 7919 * worker);
+    //棋盘输出很多, 每个worker各写各的日志
+    if(!freopen((name + ".log").c_str(), "w", stdout)){
+        fprintf(stderr, "worker %d: cannot open %s.log\n", worker, name.c_str());
+        return 1;
+    }
+    DataWriter writer(prefix, worker);
+    if(!writer.ok()){
+        return 1;
+    }
+    God g(players_file);
+    g.logfile = name + ".txt"; //对局日志也分开, 不然几个进程会写到同一个文件里
+    if(g.telemetry){
+        g.telemetry -> SetPath(g.telemetry -> GetPath() + "." + std::to_string(worker));
+    }
+    g.GenerateData(games, &writer);
+    writer.Flush();
+    fprintf(stderr, "worker %d: %zu games, %zu records\n", worker, games, writer.written);
+    return writer.ok() ? 0 : 1;
+}
+
+int RunDataGen(const char* players_file, size_t games, int workers, const std::string& prefix){
+    #if !DATAGEN_FORK
+    //没有fork就在本进程里跑一个worker
+    workers = 1;
+    #endif
+    if(workers < 1){
+        workers = 1;
+    }
+    if(workers == 1){
+        return _run_worker(players_file, games, 0, prefix);
+    }
+    #if DATAGEN_FORK
+    std::vector<pid_t> children;
+    for(int w = 0; w < workers; ++w){
+        const size_t share = games / workers + ((size_t)w < games % workers ? 1 : 0);
+        fflush(stdout);
+        pid_t pid = fork();
+        if(pid == 0){
+            const int ret = _run_worker(players_file, share, w, prefix);
+            fflush(NULL); //_exit不会刷stdio的缓冲
+            _exit(ret);
+        }
+        if(pid < 0){
+            printf("fork worker %d FAILED!\n", w);
+            continue;
+        }
+        children.push_back(pid);
+    }
+    int failed = 0;
+    for(pid_t pid : children){
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+            ++failed;
+        }
+    }
+    printf("datagen: %d workers finished, %d failed\n", (int)children.size(), failed);
+    return (failed || (int)children.size() != workers) ? 1 : 0;
+    #endif
+    return 0;
+}
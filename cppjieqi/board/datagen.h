@@ -0,0 +1,54 @@
+#ifndef datagen_h
+#define datagen_h
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdio.h>
+#include "../global/global.h"
+#include "../score/score.h"
+
+#define DATA_RECORDS_PER_CHUNK (1 << 20) //每个chunk文件最多这么多条, 约108MB
+#define DATA_BUFFER_RECORDS 4096 //攒够这么多条才真正写一次文件
+
+//自对弈数据: 每个搜索过的局面一条定长记录, 小端, 直接按结构体读写
+//board是红方视角(state_red)的90个格子, 存的是SID(c), 暗子就是暗子(行棋方看到的局面)
+//pool是行棋方眼里的暗子池(di_red或di_black), [1]红[0]黑, 顺序是RNBACP
+struct DataRecord{
+    int16_t score; //搜索分数, 行棋方视角
+    unsigned char board[SQUARE_NUM];
+    unsigned char pool[2][6];
+    unsigned char turn; //1红走, 0黑走
+    unsigned char depth; //搜索深度
+    unsigned char round;
+    int8_t result; //对局结果, 红方视角: 1红胜, 0和, -1黑胜
+};
+static_assert(sizeof(DataRecord) == 108, "DataRecord must stay 108 bytes, old datasets depend on it");
+
+//只追加的分块写入: prefix.<worker>.<chunk>.bin, 重新运行时接着最后一个没写满的chunk写
+class DataWriter{
+public:
+    DataWriter(const std::string& prefix, int worker);
+    ~DataWriter();
+    bool ok() const{
+        return _ok;
+    }
+    void Append(const DataRecord* records, size_t num);
+    void Flush();
+    size_t written = 0;
+private:
+    std::string _prefix;
+    int _worker;
+    size_t _chunk = 0;
+    size_t _in_chunk = 0; //当前chunk里已有的条数
+    FILE* _file = NULL;
+    bool _ok = false;
+    std::vector<DataRecord> _buffer;
+    std::string _chunk_name(size_t chunk) const;
+    bool _open_chunk();
+};
+
+//开workers个进程各跑games / workers盘, 每个进程写自己的chunk和日志(prefix.<worker>.log)
+int RunDataGen(const char* players_file, size_t games, int workers, const std::string& prefix);
+
+#endif
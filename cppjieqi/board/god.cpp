@@ -1,7 +1,7 @@
 #include "god.h"
 
 namespace board{
-    extern std::map<std::string, std::function<Thinker*(const char[], bool, int, const unsigned char [5][2][123], short, std::unordered_map<std::string, bool>*)>> bean;  //define in ../global/global.cpp
+    extern std::map<std::string, std::function<Thinker*(const char[], bool, int, const unsigned char [5][2][123], short, std::unordered_map<std::string, bool>*, EngineContext*)>> bean;  //define in ../global/global.cpp
 
     template<typename... Args>
     Thinker* get(std::string x, Args... args){
@@ -43,7 +43,7 @@ God::God(const char* file): ok(true), redwin(0), blackwin(0), draw(0), file(file
         ok = false;
         return;
     }
-    board_pointer = Singleton<board::Board>::get();
+    board_pointer = new (std::nothrow) board::Board; //每个God一个棋盘, 几局棋可以在不同线程里同时下
     std::ifstream instream(file);
     int counter = 0;
     std::string line;
@@ -53,11 +53,16 @@ God::God(const char* file): ok(true), redwin(0), blackwin(0), draw(0), file(file
         return;
     }
     while(std::getline(instream, line)){
+        line = trim(line);
         if(counter >= 4){
-            ok = false;
-            break;
+            //第5行起是可选的玩家选项, 空行和#开头的行跳过
+            if(!line.empty() && line[0] != '#' && !ParseOption(line)){
+                ok = false;
+                break;
+            }
+            ++counter;
+            continue;
         }
-        line = trim(line);
 
         if(counter == 0 && !line.empty()){
             if(!isT<int>(line, &type1)){
@@ -97,8 +102,83 @@ God::God(const char* file): ok(true), redwin(0), blackwin(0), draw(0), file(file
     instream.close();
 }
 
+//player1.key=value / player2.key=value, 例如player1.eval=nnue, player1.nodes=2000000; sprt.key=value是SPRT的参数, opening.key=value是开局集的参数, engine.seed=value是随机数种子, adjudicate.key=value是判局的参数, telemetry.file=path是每步搜索统计的输出
+bool God::ParseOption(const std::string& line){
+    const size_t dot = line.find('.');
+    const size_t eq = line.find('=');
+    if(dot == std::string::npos || eq == std::string::npos || dot > eq){
+        printf("players.conf: 无法解析的选项 %s\n", line.c_str());
+        return false;
+    }
+    const std::string player = trim(line.substr(0, dot));
+    const std::string key = trim(line.substr(dot + 1, eq - dot - 1));
+    const std::string value = trim(line.substr(eq + 1));
+    if(key.empty()){
+        printf("players.conf: 选项名为空 %s\n", line.c_str());
+        return false;
+    }
+    if(player == "sprt"){
+        double* field = key == "elo0" ? &sprt.elo0 : (key == "elo1" ? &sprt.elo1 : (key == "alpha" ? &sprt.alpha : (key == "beta" ? &sprt.beta : NULL)));
+        if(key == "max_pairs" ? !isT<size_t>(value, &sprt.max_pairs) : (!field || !isT<double>(value, field))){
+            printf("players.conf: 无法解析的SPRT选项 %s\n", line.c_str());
+            return false;
+        }
+        sprt.enabled = true;
+    }else if(player == "opening"){
+        if(key == "seed"){
+            if(!isT<uint32_t>(value, &openings.seed)){
+                printf("players.conf: 无法解析的开局种子 %s\n", line.c_str());
+                return false;
+            }
+        }else if(key == "book"){
+            if(!openings.LoadBook(value)){
+                return false;
+            }
+        }else{
+            printf("players.conf: 无法解析的开局选项 %s\n", line.c_str());
+            return false;
+        }
+        openings.enabled = true;
+    }else if(player == "adjudicate"){
+        int* field = key == "win_score" ? &adjudication.win_score : (key == "win_plies" ? &adjudication.win_plies : \
+            (key == "draw_score" ? &adjudication.draw_score : (key == "draw_plies" ? &adjudication.draw_plies : (key == "draw_round" ? &adjudication.draw_round : NULL))));
+        if(!field || !isT<int>(value, field) || *field < 0){
+            printf("players.conf: 无法解析的判局选项 %s\n", line.c_str());
+            return false;
+        }
+        adjudication.enabled = true;
+    }else if(player == "telemetry"){
+        if(key != "file" || value.empty()){
+            printf("players.conf: 无法解析的telemetry选项 %s\n", line.c_str());
+            return false;
+        }
+        telemetry.reset(new TelemetrySink(value));
+    }else if(player == "engine"){
+        if(key != "seed" || !isT<uint32_t>(value, &engine_seed)){
+            printf("players.conf: 无法解析的引擎选项 %s\n", line.c_str());
+            return false;
+        }
+        seeded = true;
+    }else if(player == "player1" || player == "player2"){
+        uint64_t limit = 0;
+        if((key == "depth" || key == "nodes" || key == "movetime") && !isT<uint64_t>(value, &limit)){
+            printf("players.conf: 搜索限制必须是非负整数 %s\n", line.c_str());
+            return false;
+        }
+        (player == "player1" ? options1 : options2)[key] = value;
+    }else{
+        printf("players.conf: 未知的玩家 %s\n", player.c_str());
+        return false;
+    }
+    return true;
+}
+
 God::~God(){
-   Singleton<board::Board>::deleteT();
+   if(telemetry && !telemetry -> summary.empty()){
+       telemetry -> Flush();
+       telemetry -> summary.Print();
+   }
+   delete board_pointer;
    if(thinker1) thinker1.reset();
    if(thinker2) thinker2.reset();
 }
@@ -119,10 +199,13 @@ int God::StartThinker(std::ofstream* of){
             printf("红空指针!\n");
             return BLACK_WIN;
         }
+        thinker1 -> options = &options1;
         thinker1 -> thinker_type = type1;
         thinker1 -> retry_num = thinker1 -> thinker_type?1:5;
         for(int i = 0; i < thinker1 -> retry_num; ++i){
+            const auto think_start = std::chrono::high_resolution_clock::now();
             std::string think_result = thinker1 -> Think(); // This function might cost a lot of time!
+            const size_t think_ms = (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - think_start).count();
             std::string trim_think_result = trim(think_result);
             if(trim_think_result == "R" || trim_think_result == "r"){
                 return BLACK_WIN;
@@ -134,11 +217,19 @@ int God::StartThinker(std::ofstream* of){
                 return WASTE;
             }
             if(!check_legal(think_result)) continue;
+            DataRecord record;
+            if(datagen){
+                MakeRecord(thinker1.get(), &record);
+            }
             std::shared_ptr<InfoDict> p = board_pointer -> Move(think_result, true);
             if(p && p -> islegal){
                 if(of){
                     (*of) << think_result << "\n";
                 }
+                if(datagen && thinker1 -> search_depth > 0){
+                    game_records.push_back(record);
+                }
+                RecordTelemetry(thinker1.get(), type1, options1, true, think_ms);
                 red_eat_black.push_back({p -> eat, p -> eat_type, 195 - 16 * p -> dst_x + p -> dst_y, p -> eat_check});
                 board_pointer -> PrintPos(!board_pointer -> turn, true, false, true);
                 printf("第%d轮红方行棋结束\n========================================\n\n", board_pointer -> round);
@@ -160,10 +251,13 @@ int God::StartThinker(std::ofstream* of){
             printf("黑空指针!\n");
             return RED_WIN;
         }
+        thinker2 -> options = &options2;
         thinker2 -> thinker_type = type2;
         thinker2 -> retry_num = thinker2 -> thinker_type?1:5;
         for(int i = 0; i < thinker2 -> retry_num; ++i){
+            const auto think_start = std::chrono::high_resolution_clock::now();
             std::string think_result = thinker2 -> Think(); // This function might cost a lot of time!
+            const size_t think_ms = (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - think_start).count();
             std::string trim_think_result = trim(think_result);
             if(trim_think_result == "R" || trim_think_result == "r"){
                 return RED_WIN;
@@ -175,11 +269,19 @@ int God::StartThinker(std::ofstream* of){
                 return WASTE;
             }
             if(!check_legal(think_result)) continue;
+            DataRecord record;
+            if(datagen){
+                MakeRecord(thinker2.get(), &record);
+            }
             std::shared_ptr<InfoDict> p = board_pointer -> Move(think_result, true);
             if(p && p -> islegal){
                 if(of){
                     (*of) << think_result << "\n";
                 }
+                if(datagen && thinker2 -> search_depth > 0){
+                    game_records.push_back(record);
+                }
+                RecordTelemetry(thinker2.get(), type2, options2, false, think_ms);
                 black_eat_red.push_back({p -> eat, p -> eat_type, 195 - 16 * p -> dst_x + p -> dst_y, p -> eat_check});
                 board_pointer -> PrintPos(!board_pointer -> turn, true, false, true);
                 printf("第%d轮黑方行棋结束\n========================================\n\n", board_pointer -> round);
@@ -192,6 +294,62 @@ int God::StartThinker(std::ofstream* of){
    return NORMAL;
 }
 
+void God::RecordTelemetry(const board::Thinker* thinker, int type, const std::unordered_map<std::string, std::string>& options, bool red, size_t ms){
+    if(!telemetry || type == 0 || thinker -> search_depth == 0){
+        return;
+    }
+    MoveTelemetry move;
+    move.engine = "AI" + std::to_string(type);
+    if(!options.empty()){
+        //按key排序, 同一组选项不管unordered_map里什么顺序都是同一个名字
+        const std::map<std::string, std::string> sorted(options.begin(), options.end());
+        std::string joined;
+        for(auto& it : sorted){
+            joined += (joined.empty() ? "" : ";") + it.first + "=" + it.second;
+        }
+        std::replace(joined.begin(), joined.end(), ',', '_');
+        std::replace(joined.begin(), joined.end(), '"', '_');
+        move.engine += "{" + joined + "}";
+    }
+    move.game = games_started - 1;
+    move.round = board_pointer -> round;
+    move.red = red;
+    move.depth = thinker -> search_depth;
+    move.nodes = thinker -> search_nodes;
+    move.qnodes = thinker -> search_qnodes;
+    move.ms = ms;
+    move.tt_probes = thinker -> tt_probes;
+    move.tt_hits = thinker -> tt_hits;
+    move.evals = thinker -> eval_calls;
+    move.score = thinker -> search_score;
+    telemetry -> Append(move);
+}
+
+int God::Adjudicate(std::ofstream* of){
+    //turn已经换过了, 刚走的是另一方
+    const bool red_moved = !board_pointer -> turn;
+    const board::Thinker* thinker = red_moved ? thinker1.get() : thinker2.get();
+    const bool searched = thinker && thinker -> search_depth > 0;
+    const int red_score = searched ? (red_moved ? thinker -> search_score : -thinker -> search_score) : 0;
+    bool revealed = true;
+    for(int i = 51; i <= 203 && revealed; ++i){
+        const char c = board_pointer -> state_red[i];
+        revealed = !((c >= 'D' && c <= 'I') || (c >= 'd' && c <= 'i'));
+    }
+    std::string reason;
+    const int verdict = adjudicator.Update(adjudication, searched, red_score, board_pointer -> round, revealed, &reason);
+    if(verdict == ADJUDICATE_NONE){
+        return NORMAL;
+    }
+    const int result = verdict == ADJUDICATE_RED ? RED_WIN : (verdict == ADJUDICATE_BLACK ? BLACK_WIN : DRAW);
+    printf("判局(%s): %s\n", result == RED_WIN ? "红胜" : (result == BLACK_WIN ? "黑胜" : "和棋"), reason.c_str());
+    if(of){
+        //带CLAIM的行回放时会跳过
+        (*of) << "CLAIM ADJUDICATION " << result << " " << reason << "\n";
+    }
+    return result;
+}
+
 void God::Play(std::string logfile){
     printf("\n对局回顾!\n");
     std::ifstream in(logfile);
@@ -287,17 +445,33 @@ void God::Play(){
 }
 
 int God::StartGame(){
+    return StartGame(NULL);
+}
+
+int God::StartOpening(size_t index){
+    Opening opening;
+    openings.Get(index, board_pointer, &opening);
+    printf("开局No.%zu (seed = %u, %zu步前缀)\n", index, openings.seed, opening.moves.size());
+    return StartGame(&opening.random_map, &opening.moves);
+}
+
+int God::StartGame(std::unordered_map<bool, std::unordered_map<unsigned char, char>>* random_map, const std::vector<std::string>* prefix){
     red_eat_black.clear();
     black_eat_red.clear();
-    tp_move_bean.clear();
-    tp_score_bean.clear();
+    game_records.clear();
+    context.ClearTables();
+    adjudicator.Reset();
+    ++games_started;
+    if(seeded){
+        context.rng.seed(engine_seed);
+    }
     bool write = false;
     std::ofstream of(logfile, std::ios::app);
     if(of.is_open()){
         write = true;
     }
     int result = NORMAL;
-    board_pointer -> Reset(NULL);
+    board_pointer -> Reset(random_map);
     if(write){
         of << "# ";
         for(auto it = board_pointer -> random_map[true].begin(); it != board_pointer -> random_map[true].end(); ++it){
@@ -309,8 +483,28 @@ int God::StartGame(){
         }
         of << "\n";
     }
+    if(prefix){
+        //开局前缀不经过thinker, 照常写进日志, Play回放时和普通走法一样
+        for(const std::string& move : *prefix){
+            board_pointer -> GenMovesWithScore();
+            const bool turn = board_pointer -> turn;
+            std::shared_ptr<InfoDict> p = board_pointer -> Move(move, true);
+            if(!p || !p -> islegal || p -> win){
+                printf("[FAILED 0]board --> god.cpp --> StartGame --> 开局走法%s不合法或直接分出胜负, 这盘作废!\n", move.c_str());
+                return WASTE;
+            }
+            if(write){
+                of << move << "\n";
+            }
+            (turn ? red_eat_black : black_eat_red).push_back({p -> eat, p -> eat_type, 195 - 16 * p -> dst_x + p -> dst_y, p -> eat_check});
+        }
+        board_pointer -> PrintPos(board_pointer -> turn, true, false, true);
+    }
     while(result == NORMAL && board_pointer -> round < MAX_ROUNDS){
         result = StartThinker(write ? &of : NULL);
+        if(result == NORMAL && adjudication.enabled){
+            result = Adjudicate(write ? &of : NULL);
+        }
         if(result == -1) {
             printf("BUG!\n");
             return -1;
@@ -391,7 +585,7 @@ int God::StartGameLoopAlternatively(size_t winning_threshold){
     redwin = 0;
     draw = 0;
     blackwin = 0;
-    if(winning_threshold == 0) {
+    if(winning_threshold == 0 && !sprt.enabled) {
         return DRAW;
     }
     size_t player1win = 0;
@@ -399,9 +593,17 @@ int God::StartGameLoopAlternatively(size_t winning_threshold){
     size_t i = 0;
     bool cnt = true;
     size_t maxgame = 2 * winning_threshold - 1;
-    while(i < maxgame && draw < maxgame){
+    Pentanomial pentanomial;
+    int pair_points = 0; //这一对里玩家1已经得了几个半分, -1表示这一对有一盘作废
+    size_t games = 0; //已经开始的盘数, 打开开局集时第games / 2个开局红黑各下一盘
+    //SPRT也要有上限: sprt.max_pairs, 没写就按胜利阈值算的盘数, 都没有用SPRT_DEFAULT_MAX_PAIRS
+    const size_t max_sprt_games = sprt.max_pairs ? 2 * sprt.max_pairs : (winning_threshold ? maxgame + 1 : 2 * SPRT_DEFAULT_MAX_PAIRS);
+    size_t wasted = 0; //连续作废的盘数
+    while(sprt.enabled ? games < max_sprt_games && wasted < SPRT_MAX_WASTED : (i < maxgame && draw < maxgame)){
         printf("cnt = %d. Player1_win %zu : Draw %zu : Player2_win %zu\n", cnt, player1win, draw, player2win);
-        int state = StartGame();
+        int state = openings.enabled ? StartOpening(games / 2) : StartGame();
+        ++games;
+        wasted = (state == RED_WIN || state == BLACK_WIN || state == DRAW) ? 0 : wasted + 1;
         if(cnt){
             if(state == RED_WIN){
                 ++player1win;
@@ -419,7 +621,19 @@ int God::StartGameLoopAlternatively(size_t winning_threshold){
                 ++i;
             }
         }
-        if(player1win >= winning_threshold){
+        int decision = SPRT_CONTINUE;
+        if(sprt.enabled){
+            //cnt为true时玩家1执红, 和下一盘(玩家1执黑)凑成一对
+            const int points = state == DRAW ? 1 : (state == RED_WIN ? (cnt ? 2 : 0) : (state == BLACK_WIN ? (cnt ? 0 : 2) : -1));
+            if(cnt){
+                pair_points = points;
+            }else if(pair_points >= 0 && points >= 0){
+                pentanomial.Add(pair_points + points);
+                printf("SPRT: %s\n", pentanomial.Report(sprt).c_str());
+                decision = pentanomial.Decide(sprt);
+            }
+        }
+        if(!sprt.enabled && player1win >= winning_threshold){
             printf("玩家1获胜!\n");
             printf("cnt = %d. Player1_win %zu : Draw %zu : Player2_win %zu\n", cnt, player1win, draw, player2win);
             std::ofstream of(logfile, std::ios::app);
@@ -427,7 +641,7 @@ int God::StartGameLoopAlternatively(size_t winning_threshold){
                 of << "CLAIM PLAYER1-DRAW-PLAYER2 " << player1win << "-" << draw << "-" << player2win << "\n";
             }
             return 1;
-        }else if(player2win >= winning_threshold){
+        }else if(!sprt.enabled && player2win >= winning_threshold){
             printf("玩家2获胜!\n");
             printf("cnt = %d. Player1_win %zu : Draw %zu : Player2_win %zu\n", cnt, player1win, draw, player2win);
             std::ofstream of(logfile, std::ios::app);
@@ -438,6 +652,34 @@ int God::StartGameLoopAlternatively(size_t winning_threshold){
         }
         cnt = !cnt;
         std::swap(type1, type2);
+        std::swap(options1, options2);
+        //这一盘已经计入胜负, 红黑也换回来了(决定总是在一对的第二盘), 再结束
+        if(decision != SPRT_CONTINUE){
+            printf("cnt = %d. Player1_win %zu : Draw %zu : Player2_win %zu\n", cnt, player1win, draw, player2win);
+            std::ofstream of(logfile, std::ios::app);
+            if(of.is_open()){
+                of << "CLAIM PLAYER1-DRAW-PLAYER2 " << player1win << "-" << draw << "-" << player2win << "\n";
+            }
+            of.close();
+            ClaimSPRT(pentanomial, decision);
+            return decision == SPRT_H1 ? 1 : 0;
+        }
+    }
+    if(sprt.enabled){
+        //停在一对的中间(连续作废)时把玩家1换回红方
+        if(!cnt){
+            std::swap(type1, type2);
+            std::swap(options1, options2);
+        }
+        printf(wasted >= SPRT_MAX_WASTED ? "连续%zu盘作废, SPRT没有结论!\n" : "下满%zu盘, SPRT没有结论!\n", wasted >= SPRT_MAX_WASTED ? wasted : games);
+        printf("cnt = %d. Player1_win %zu : Draw %zu : Player2_win %zu\n", cnt, player1win, draw, player2win);
+        std::ofstream of(logfile, std::ios::app);
+        if(of.is_open()){
+            of << "CLAIM PLAYER1-DRAW-PLAYER2 " << player1win << "-" << draw << "-" << player2win << "\n";
+        }
+        of.close();
+        ClaimSPRT(pentanomial, SPRT_CONTINUE);
+        return 0;
     }
     printf("握手言和!\n");
     printf("cnt = %d. Player1_win %zu : Draw %zu : Player2_win %zu\n", cnt, player1win, draw, player2win);
@@ -452,6 +694,66 @@ int God::StartGameLoopAlternatively(){
    return StartGameLoopAlternatively(winning_threshold_class);
 }
 
+//SPRT的结论写进日志, decision是SPRT_H0/SPRT_H1, 对局数用完还没结论时是SPRT_CONTINUE
+void God::ClaimSPRT(const Pentanomial& pentanomial, int decision){
+    const char* result = decision == SPRT_H1 ? "H1" : (decision == SPRT_H0 ? "H0" : "NONE");
+    printf("SPRT结束(%s): %s\n", result, pentanomial.Report(sprt).c_str());
+    std::ofstream of(logfile, std::ios::app);
+    if(!of.is_open()){
+        return;
+    }
+    double error = 0.0;
+    const double elo = pentanomial.Elo(&error);
+    char line[128];
+    snprintf(line, sizeof(line), "LLR=%.2f ELO=%.1f+-%.1f", pentanomial.LLR(sprt), elo, error);
+    of << "CLAIM PENTANOMIAL " << pentanomial.pairs[0] << "-" << pentanomial.pairs[1] << "-" << pentanomial.pairs[2] << "-" << pentanomial.pairs[3] << "-" << pentanomial.pairs[4] << "\n";
+    of << "CLAIM SPRT " << result << " " << line << "\n";
+}
+
+//走子之前的局面, 行棋方看到的棋盘和暗子池
+void God::MakeRecord(const board::Thinker* thinker, DataRecord* record) const{
+    const bool turn = board_pointer -> turn;
+    const unsigned char (*pool)[123] = turn ? board_pointer -> di_red[0] : board_pointer -> di_black[0];
+    const char pieces[] = "RNBACP";
+    memset(record, 0, sizeof(DataRecord));
+    record -> score = thinker -> search_score;
+    for(int i = 51; i <= 203; ++i){
+        if((i & 15) < 3 || (i & 15) > 11) { continue; }
+        record -> board[SQ(i)] = SID(board_pointer -> state_red[i]);
+    }
+    for(int k = 0; k < 6; ++k){
+        record -> pool[1][k] = pool[1][(int)pieces[k]];
+        record -> pool[0][k] = pool[0][(int)pieces[k] ^ 32];
+    }
+    record -> turn = turn ? 1 : 0;
+    record -> depth = (unsigned char)std::min(thinker -> search_depth, 255);
+    record -> round = (unsigned char)std::min(board_pointer -> round, 255);
+}
+
+//自对弈生成训练数据, 和StartGameLoopAlternatively一样每盘交换红黑
+int God::GenerateData(size_t games, DataWriter* writer){
+    datagen = writer;
+    size_t records = 0;
+    for(size_t i = 0; i < games && writer -> ok(); ++i){
+        const int state = StartGame();
+        const int8_t result = state == RED_WIN ? 1 : (state == BLACK_WIN ? -1 : 0);
+        if(state == RED_WIN || state == BLACK_WIN || state == DRAW){
+            for(DataRecord& record : game_records){
+                record.result = result;
+            }
+            writer -> Append(game_records.data(), game_records.size());
+            records += game_records.size();
+        }
+        game_records.clear();
+        printf("datagen: game %zu/%zu, result = %d, records = %zu\n", i + 1, games, state == WASTE ? 0 : result, records);
+        std::swap(type1, type2);
+        std::swap(options1, options2);
+    }
+    writer -> Flush();
+    datagen = NULL;
+    return 0;
+}
+
 bool God::GetTurn(){
    return board_pointer -> turn;
 }
@@ -11,7 +11,13 @@
 #include "board.h"
 #include "thinker.h"
 #include "human.h"
+#include "datagen.h"
+#include "sprt.h"
+#include "opening.h"
+#include "adjudicate.h"
+#include "telemetry.h"
 #include "../global/global.h"
+#include "../global/context.h"
 #include "../score/score.h"
 
 
@@ -22,10 +28,8 @@
 #define WASTE 3
 #define DRAW 4
 #define MAX_ROUNDS 200
-#define NEWRED(X) board::get_withprefix("AIBoard", X, board_pointer -> state_red, board_pointer -> turn, board_pointer -> round, board_pointer -> di_red, 0, &board_pointer -> hist)
-#define NEWBLACK(X) board::get_withprefix("AIBoard", X, board_pointer -> state_black, board_pointer -> turn, board_pointer -> round, board_pointer -> di_black, 0, &board_pointer -> hist)
-extern std::unordered_map<int, std::unordered_map<std::pair<uint32_t, bool>, std::pair<unsigned char, unsigned char>, myhash<uint32_t, bool>>> tp_move_bean;
-extern std::unordered_map<int, std::unordered_map<std::pair<uint32_t, int>, std::pair<short, short>, myhash<uint32_t, int>>> tp_score_bean;
+#define NEWRED(X) board::get_withprefix("AIBoard", X, board_pointer -> state_red, board_pointer -> turn, board_pointer -> round, board_pointer -> di_red, 0, &board_pointer -> hist, &context)
+#define NEWBLACK(X) board::get_withprefix("AIBoard", X, board_pointer -> state_black, board_pointer -> turn, board_pointer -> round, board_pointer -> di_black, 0, &board_pointer -> hist, &context)
 
 struct God{
     char eat = '.';
@@ -38,10 +42,23 @@ struct God{
     size_t draw = 0;
     std::string file;
     std::string logfile;
+    std::unordered_map<std::string, std::string> options1; //玩家1的选项, 跟着type1走
+    std::unordered_map<std::string, std::string> options2; //玩家2的选项, 跟着type2走
+    SPRTConfig sprt; //sprt.xxx=value, 打开以后胜利阈值不再起作用, 一直下到SPRT有结论
+    OpeningSuite openings; //opening.seed=value, opening.book=path, 打开以后每两盘用同一个固定开局
+    AdjudicationConfig adjudication; //adjudicate.xxx=value, 按双方报的分数提前判胜负或和棋
+    Adjudicator adjudicator;
+    bool seeded = false; //engine.seed=value, 每局开始时用它重置context的随机数, 同一个开局下出来的棋每次都一样
+    uint32_t engine_seed = 0;
+    DataWriter* datagen = NULL; //不为NULL时记录每个搜索过的局面
+    std::unique_ptr<TelemetrySink> telemetry; //telemetry.file=path, 记录每一步的搜索统计
+    uint64_t games_started = 0;
+    std::vector<DataRecord> game_records; //这盘棋的记录, 终局后填上结果再写出去
     std::vector<std::tuple<char, int, int, char>> red_eat_black;
     std::vector<std::tuple<char, int, int, char>> black_eat_red;
     std::unordered_set<std::string> hist_cache;
-    board::Board* board_pointer;
+    board::Board* board_pointer = NULL;
+    EngineContext context; //两个玩家的置换表、PST和随机数, 每局开始时清空置换表
     std::unique_ptr<board::Thinker> thinker1; //Red Thinker
     std::unique_ptr<board::Thinker> thinker2; //Black Thinker
     God()=delete;
@@ -49,14 +66,22 @@ struct God{
     ~God();
     bool GetTurn();
     int StartThinker(std::ofstream* of);
+    void RecordTelemetry(const board::Thinker* thinker, int type, const std::unordered_map<std::string, std::string>& options, bool red, size_t ms);
+    int Adjudicate(std::ofstream* of); //刚走完的一步之后看要不要判, 返回NORMAL/RED_WIN/BLACK_WIN/DRAW
     void Play(std::string logfile);
     void Play();
     int StartGame();
+    int StartGame(std::unordered_map<bool, std::unordered_map<unsigned char, char>>* random_map, const std::vector<std::string>* prefix = NULL); //指定暗子布局, NULL则随机; prefix是双方先走的开局前缀
+    int StartOpening(size_t index); //下开局集里的第index个开局
     int StartGameLoop(size_t winning_threshold);
     int StartGameLoop();
     int StartGameLoopAlternatively(size_t winning_threshold);//红黑交替
     int StartGameLoopAlternatively();//红黑交替
     std::string PrintEat(bool turn, bool SHOWDARK);
+    bool ParseOption(const std::string& line);
+    void ClaimSPRT(const Pentanomial& pentanomial, int decision);
+    void MakeRecord(const board::Thinker* thinker, DataRecord* record) const;
+    int GenerateData(size_t games, DataWriter* writer);
 
     std::function<std::string(const char)> getstring = [](const char c) -> std::string {
         std::string ret;
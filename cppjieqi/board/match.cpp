@@ -0,0 +1,216 @@
+#include "match.h"
+#include "god.h"
+#include <thread>
+#if defined(WIN32) || defined(_WIN32)
+#define MATCH_FORK 0
+#else
+#define MATCH_FORK 1
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#endif
+#define MATCH_REPORT_US 200000 //主进程多久看一次计数器
+
+static void _clear_stats(MatchStats* stats){
+    for(std::atomic<uint64_t>* p : {&stats -> next_pair, &stats -> games, &stats -> player1win, &stats -> draw, &stats -> player2win, &stats -> redwin, &stats -> blackwin, &stats -> waste}){
+        p -> store(0);
+    }
+    for(std::atomic<uint64_t>& p : stats -> pentanomial){
+        p.store(0);
+    }
+    stats -> stop.store(0);
+}
+
+static Pentanomial _load_pentanomial(const MatchStats* stats){
+    Pentanomial pentanomial;
+    for(int k = 0; k < 5; ++k){
+        pentanomial.pairs[k] = stats -> pentanomial[k].load();
+    }
+    return pentanomial;
+}
+
+static void _print_stats(const MatchStats* stats, size_t total){
+    printf("match: %zu/%zu games. Player1_win %zu : Draw %zu : Player2_win %zu (红胜%zu 黑胜%zu 作废%zu)\n", (size_t)stats -> games.load(), total, (size_t)stats -> player1win.load(), (size_t)stats -> draw.load(), (size_t)stats -> player2win.load(), (size_t)stats -> redwin.load(), (size_t)stats -> blackwin.load(), (size_t)stats -> waste.load());
+    fflush(stdout);
+}
+
+//同一个暗子布局下两盘: 第一盘玩家1执红, 第二盘交换红黑
+//打开开局集时第index对用开局集里的第index个开局, 和哪个worker领到无关
+static void _play_pair(God* g, MatchStats* stats, size_t index){
+    Opening opening;
+    if(g -> openings.enabled){
+        g -> openings.Get(index, g -> board_pointer, &opening);
+    }else{
+        g -> board_pointer -> Reset(NULL);
+        opening.random_map = g -> board_pointer -> random_map;
+    }
+    int points = 0; //玩家1这一对得了几个半分
+    bool wasted = false;
+    for(int k = 0; k < 2; ++k){
+        std::unordered_map<bool, std::unordered_map<unsigned char, char>> random_map = opening.random_map; //Reset会把它move走
+        const int state = g -> StartGame(&random_map, &opening.moves);
+        if(state == RED_WIN || state == BLACK_WIN){
+            ((state == RED_WIN) == (k == 0) ? stats -> player1win : stats -> player2win).fetch_add(1);
+            points += (state == RED_WIN) == (k == 0) ? 2 : 0;
+            (state == RED_WIN ? stats -> redwin : stats -> blackwin).fetch_add(1);
+        }else if(state == DRAW){
+            stats -> draw.fetch_add(1);
+            points += 1;
+        }else{
+            stats -> waste.fetch_add(1);
+            wasted = true;
+        }
+        stats -> games.fetch_add(1);
+        std::swap(g -> type1, g -> type2);
+        std::swap(g -> options1, g -> options2);
+    }
+    if(!wasted){
+        stats -> pentanomial[points].fetch_add(1);
+    }
+}
+
+static int _run_worker(God* g, MatchStats* stats, size_t pairs, int worker){
+    srand(time(NULL) + 7919 * worker);
+    #if MATCH_FORK
+    //棋盘和搜索信息都不要了, 进度由主进程打印
+    if(!freopen("/dev/null", "w", stdout)){
+        fprintf(stderr, "worker %d: cannot redirect stdout\n", worker);
+        return 1;
+    }
+    #endif
+    if(!g -> logfile.empty()){
+        //几个进程不能写同一个日志, 每个worker一个, 可以用God::Play回放
+        g -> logfile += "." + std::to_string(worker);
+        std::ofstream(g -> logfile, std::ios_base::trunc);
+    }
+    if(g -> telemetry){
+        g -> telemetry -> SetPath(g -> telemetry -> GetPath() + "." + std::to_string(worker));
+    }
+    while(!stats -> stop.load()){
+        const size_t index = stats -> next_pair.fetch_add(1);
+        if(index >= pairs){
+            break;
+        }
+        _play_pair(g, stats, index);
+    }
+    if(g -> telemetry){
+        g -> telemetry -> Flush();
+    }
+    return 0;
+}
+
+int RunMatch(const char* players_file, size_t pairs, int workers){
+    God g(players_file);
+    if(!g.ok){
+        return 0;
+    }
+    if(workers < 1){
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers = (int)std::min<size_t>(workers, std::max<size_t>(pairs, 1));
+    const std::string logfile = g.logfile;
+    printf("match: %zu pairs (%zu games), %d workers\n", pairs, 2 * pairs, workers);
+    if(g.openings.enabled){
+        printf("match: 固定开局, seed = %u, %zu个开局前缀\n", g.openings.seed, g.openings.book.size());
+    }
+    #if MATCH_FORK
+    void* shared = mmap(NULL, sizeof(MatchStats), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(shared == MAP_FAILED){
+        printf("[FAILED 0]board --> match.cpp --> RunMatch --> mmap FAILED!\n");
+        return 0;
+    }
+    MatchStats* stats = new (shared) MatchStats;
+    _clear_stats(stats);
+    size_t alive = 0;
+    int failed = 0;
+    for(int w = 0; w < workers; ++w){
+        fflush(stdout);
+        pid_t pid = fork();
+        if(pid == 0){
+            //子进程直接用fork出来的God, 不用再读一遍players.conf
+            const int ret = _run_worker(&g, stats, pairs, w);
+            fflush(NULL); //_exit不会刷stdio的缓冲
+            _exit(ret);
+        }
+        if(pid < 0){
+            printf("fork worker %d FAILED!\n", w);
+            ++failed;
+            continue;
+        }
+        ++alive;
+    }
+    size_t reported = 0;
+    while(alive > 0){
+        int status = 0;
+        const pid_t pid = waitpid(-1, &status, WNOHANG);
+        if(pid > 0){
+            --alive;
+            if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+                ++failed;
+            }
+            continue;
+        }
+        if(pid < 0){
+            break;
+        }
+        if(stats -> games.load() != reported){
+            reported = stats -> games.load();
+            _print_stats(stats, 2 * pairs);
+            if(g.sprt.enabled){
+                const Pentanomial pentanomial = _load_pentanomial(stats);
+                printf("SPRT: %s\n", pentanomial.Report(g.sprt).c_str());
+                if(pentanomial.Decide(g.sprt) != SPRT_CONTINUE && !stats -> stop.exchange(1)){
+                    //已经在下的那几对下完再退出, 结果照样算进去
+                    printf("match: SPRT有结论, 等正在下的对局结束\n");
+                }
+            }
+        }
+        usleep(MATCH_REPORT_US);
+    }
+    if(failed){
+        printf("match: %d workers failed\n", failed);
+    }
+    if(g.telemetry){
+        //各个worker写各自的文件, 读回来一起汇总
+        TelemetrySummary summary;
+        for(int w = 0; w < workers; ++w){
+            ReadTelemetry(g.telemetry -> GetPath() + "." + std::to_string(w), &summary);
+        }
+        summary.Print();
+    }
+    #else
+    //没有fork就在本进程里下, 棋盘照常打印
+    MatchStats local;
+    MatchStats* stats = &local;
+    _clear_stats(stats);
+    _run_worker(&g, stats, pairs, 0);
+    #endif
+    _print_stats(stats, 2 * pairs);
+    const size_t player1win = stats -> player1win.load();
+    const size_t draw = stats -> draw.load();
+    const size_t player2win = stats -> player2win.load();
+    const Pentanomial pentanomial = _load_pentanomial(stats);
+    #if MATCH_FORK
+    munmap(shared, sizeof(MatchStats));
+    #endif
+    std::ofstream of(logfile, std::ios::app);
+    if(of.is_open()){
+        of << "CLAIM PLAYER1-DRAW-PLAYER2 " << player1win << "-" << draw << "-" << player2win << "\n";
+    }
+    of.close();
+    if(g.sprt.enabled){
+        const int decision = pentanomial.Decide(g.sprt);
+        g.logfile = logfile; //没有fork时_run_worker改过它
+        g.ClaimSPRT(pentanomial, decision);
+        return decision == SPRT_H1 ? 1 : 0;
+    }
+    if(player1win > player2win){
+        printf("玩家1获胜!\n");
+        return 1;
+    }else if(player2win > player1win){
+        printf("玩家2获胜!\n");
+        return 2;
+    }
+    printf("握手言和!\n");
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef match_h
+#define match_h
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <stdio.h>
+#include "../global/global.h"
+
+//并发对局的计数器, 放在共享内存里, 各个worker进程原子地领开局、累加结果
+//每个开局(暗子布局)下两盘, 玩家1先执红再执黑
+struct MatchStats{
+    std::atomic<uint64_t> next_pair; //下一个要领的开局号
+    std::atomic<uint64_t> games; //下完的盘数
+    std::atomic<uint64_t> player1win;
+    std::atomic<uint64_t> draw;
+    std::atomic<uint64_t> player2win;
+    std::atomic<uint64_t> redwin; //不管谁执红, 统计红黑本身的胜率
+    std::atomic<uint64_t> blackwin;
+    std::atomic<uint64_t> waste; //作废的盘(P), 不计入胜负和
+    std::atomic<uint64_t> pentanomial[5]; //每对玩家1得0..4个半分的对数, 有一盘作废的对不算
+    std::atomic<uint64_t> stop; //SPRT有结论以后置1, worker不再领新的开局
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "MatchStats lives in shared memory, its atomics must be lock free");
+
+//按players.conf开workers个进程下pairs个开局(共2 * pairs盘), 棋盘输出全部关掉
+//返回值和StartGameLoopAlternatively一样: 1玩家1胜, 2玩家2胜, 0和
+//players.conf里配了sprt.*时pairs是上限, SPRT有结论就提前停, 返回1接受H1, 0接受H0或没有结论
+int RunMatch(const char* players_file, size_t pairs, int workers);
+
+#endif
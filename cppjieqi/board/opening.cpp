@@ -0,0 +1,48 @@
+#include "opening.h"
+#include <fstream>
+#include <sstream>
+
+//开局库文件: 每行一个开局, ucci走法用空格隔开(例如h2e2 b0c2, 黑方走法是黑方视角), 空行和#开头的行跳过
+bool OpeningSuite::LoadBook(const std::string& path){
+    std::ifstream in(path);
+    if(!in.is_open()){
+        printf("[FAILED 0]board --> opening.cpp --> LoadBook --> %s is NOT open!\n", path.c_str());
+        return false;
+    }
+    book.clear();
+    std::string line;
+    size_t lineno = 0;
+    while(std::getline(in, line)){
+        ++lineno;
+        line = trim(line);
+        if(line.empty() || line[0] == '#'){
+            continue;
+        }
+        std::vector<std::string> moves;
+        std::istringstream ss(line);
+        std::string move;
+        while(ss >> move){
+            if(move.size() != 4 || move[0] < 'a' || move[0] > 'i' || move[1] < '0' || move[1] > '9' || move[2] < 'a' || move[2] > 'i' || move[3] < '0' || move[3] > '9'){
+                printf("[FAILED 1]board --> opening.cpp --> LoadBook --> %s:%zu: 无效的走法%s\n", path.c_str(), lineno, move.c_str());
+                return false;
+            }
+            moves.push_back(move);
+        }
+        book.push_back(moves);
+    }
+    printf("opening: 从%s读了%zu个开局前缀\n", path.c_str(), book.size());
+    return true;
+}
+
+void OpeningSuite::Get(size_t index, board::Board* board, Opening* opening) const{
+    //seed_seq和mt19937的算法都是标准规定的, 同一个(seed, index)到哪都生成同一个布局
+    std::seed_seq seq{seed, (uint32_t)index, (uint32_t)((uint64_t)index >> 32)};
+    std::mt19937 rng(seq);
+    board -> Reset(NULL); //回到初始局面, 布局只和初始局面有关
+    board -> GenerateRandomMap(&rng);
+    opening -> random_map = board -> random_map;
+    opening -> moves.clear();
+    if(!book.empty()){
+        opening -> moves = book[index % book.size()];
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef opening_h
+#define opening_h
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <stdio.h>
+#include "board.h"
+
+//固定的开局集: 第index个开局的暗子布局只由(seed, index)决定, 再按顺序配上开局库里的一行走法
+//同一个开局红黑各下一盘, 换种子之前每次跑出来的开局都一样, 运气的影响大部分在一对里抵消
+struct Opening{
+    std::unordered_map<bool, std::unordered_map<unsigned char, char>> random_map;
+    std::vector<std::string> moves; //开局前缀, ucci, 从红方开始交替走, 黑方的走法和日志里一样是黑方视角
+};
+
+struct OpeningSuite{
+    bool enabled = false; //players.conf里出现opening.seed或opening.book就打开
+    uint32_t seed = 0;
+    std::vector<std::vector<std::string>> book; //每行一个开局前缀, 空表示只用布局
+    bool LoadBook(const std::string& path);
+    //board用来生成布局, 会被Reset掉
+    void Get(size_t index, board::Board* board, Opening* opening) const;
+};
+
+#endif
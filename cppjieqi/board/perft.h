@@ -0,0 +1,54 @@
+#ifndef perft_h
+#define perft_h
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdio.h>
+#include "board.h"
+
+#define PERFT_PIECE_TYPES 6 //暗子能翻成的子: 车马相仕炮兵
+#define PERFT_TYPE_CHARS "RNBACP" //PerftPosition::pool的第二维按这个顺序
+#define PERFT_MAX_CHILDREN (MAX_POSSIBLE_MOVES * PERFT_PIECE_TYPES)
+#define PERFT_DEFAULT_DEPTH 3
+#define PERFT_MAX_REPORT 10 //对拍时最多打印这么多个不一致的局面, 后面的只计数
+
+//perft的计数规则(cppjieqi和cppjieqi2一样, 同一个局面两边的数要相等):
+//1. 数走depth步以后的叶子个数. 着法是伪合法的(可以送将), 和引擎的走法生成一样, 不管重复局面
+//2. 走暗子是机会节点: 行棋方还可能藏在暗子里的每一种子各算一个分支, 不管这种子还剩几个(不按概率加权)
+//   一方可能藏的子 = 车马相仕炮各2兵5 - 棋盘上这一方已经翻开的, 翻开一个减一个; 吃掉暗子不翻开, 也不改变这个集合
+//3. 行棋方能吃将(帅)的局面已经分出胜负, 不再展开, 它下面的叶子不算(引擎也是这样, 有的走法生成找到吃将就不往下生成了)
+struct PerftMove{
+    unsigned char src, dst; //红方视角的格子
+    char reveal; //走暗子时翻开成什么(大写的RNBACP), 不是暗子为0
+};
+
+//FEN: 10行从黑方底线到红方底线, 用/隔开, 每行从a列到i列, 数字是连续的空格
+//红方RNBAKCP, 黑方rnbakcp, 暗子按它的初始位置写DEFGHI/defghi(暗车暗马暗相暗仕暗炮暗兵), 暗子只能在对应的初始位置上
+//后面空格隔开w(红走)或b(黑走)
+struct PerftPosition{
+    std::string name;
+    char state[MAX]; //和Board::state_red的格式一样
+    bool turn;
+    int pool[2][PERFT_PIECE_TYPES]; //[turn][子]: 这一方的暗子还可能是几个这种子
+    bool Parse(const std::string& fen);
+    std::string Fen() const;
+};
+
+//一个走法生成器: 摆好局面以后跟着走子/悔棋, 随时能生成行棋方的全部着法
+//Setup和构造都在主线程里做(AIBoard的构造会碰全局的表), Generate/Make/Unmake可以在各自的线程里调
+struct PerftGenerator{
+    virtual ~PerftGenerator() = default;
+    virtual const char* Name() const = 0;
+    virtual void Setup(const PerftPosition& position) = 0;
+    virtual int Generate(PerftMove moves[MAX_POSSIBLE_MOVES], bool* mate) = 0; //reveal不填; *mate为true表示能吃将, 这时着法可以不全
+    virtual void Make(const PerftMove& move) = 0;
+    virtual void Unmake() = 0;
+};
+
+//fens为空时用内置的局面集. 每个局面先让每个生成器单独数一遍(看速度),
+//再用裁判的Board::GenMovesWithScore展开、在每个内部节点上和其他生成器逐个着法对拍
+//根节点的子节点分给threads个线程(0表示按CPU核数), 返回0表示叶子数全部一致、对拍没有不一致
+int RunPerft(int depth, int threads, const std::vector<std::string>& fens);
+
+#endif
@@ -0,0 +1,94 @@
+#include "sprt.h"
+#include <cmath>
+#include <algorithm>
+#define SPRT_EMPTY_FREQ 1e-3 //空的格子当作出现过这么多次, 不然全胜或全和的时候方差是0
+
+static double _elo_to_score(double elo){
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+static double _score_to_elo(double score){
+    score = std::min(std::max(score, 1e-6), 1.0 - 1e-6);
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+double SPRTConfig::LowerBound() const{
+    return log(beta / (1.0 - alpha));
+}
+
+double SPRTConfig::UpperBound() const{
+    return log((1.0 - beta) / alpha);
+}
+
+void Pentanomial::Add(int half_points){
+    ++pairs[std::min(std::max(half_points, 0), 4)];
+}
+
+uint64_t Pentanomial::Num() const{
+    return pairs[0] + pairs[1] + pairs[2] + pairs[3] + pairs[4];
+}
+
+double Pentanomial::Score(double* variance) const{
+    double freq[5];
+    double total = 0.0;
+    for(int i = 0; i < 5; ++i){
+        freq[i] = pairs[i] ? (double)pairs[i] : SPRT_EMPTY_FREQ;
+        total += freq[i];
+    }
+    double mean = 0.0;
+    for(int i = 0; i < 5; ++i){
+        mean += freq[i] / total * (i / 4.0);
+    }
+    double var = 0.0;
+    for(int i = 0; i < 5; ++i){
+        var += freq[i] / total * (i / 4.0 - mean) * (i / 4.0 - mean);
+    }
+    if(variance){
+        *variance = var;
+    }
+    return mean;
+}
+
+double Pentanomial::Elo(double* error) const{
+    double var = 0.0;
+    const double mean = Score(&var);
+    const uint64_t n = Num();
+    if(error){
+        const double se = n ? sqrt(var / n) : 0.0;
+        *error = (_score_to_elo(mean + 1.96 * se) - _score_to_elo(mean - 1.96 * se)) / 2.0;
+    }
+    return _score_to_elo(mean);
+}
+
+//LLR ≈ N * (s1 - s0) * (2 * mean - s0 - s1) / (2 * var), N是对数, mean和var都按对算
+double Pentanomial::LLR(const SPRTConfig& config) const{
+    const uint64_t n = Num();
+    if(n == 0){
+        return 0.0;
+    }
+    double var = 0.0;
+    const double mean = Score(&var);
+    const double s0 = _elo_to_score(config.elo0);
+    const double s1 = _elo_to_score(config.elo1);
+    return n * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * var);
+}
+
+int Pentanomial::Decide(const SPRTConfig& config) const{
+    const double llr = LLR(config);
+    if(llr >= config.UpperBound()){
+        return SPRT_H1;
+    }
+    if(llr <= config.LowerBound()){
+        return SPRT_H0;
+    }
+    return SPRT_CONTINUE;
+}
+
+std::string Pentanomial::Report(const SPRTConfig& config) const{
+    double error = 0.0;
+    const double elo = Elo(&error);
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "pairs %zu [%zu %zu %zu %zu %zu], Elo %.1f +- %.1f, LLR %.2f [%.2f, %.2f] (elo0 = %.1f, elo1 = %.1f)", (size_t)Num(), \
+        (size_t)pairs[0], (size_t)pairs[1], (size_t)pairs[2], (size_t)pairs[3], (size_t)pairs[4], elo, error, LLR(config), config.LowerBound(), config.UpperBound(), config.elo0, config.elo1);
+    return buffer;
+}
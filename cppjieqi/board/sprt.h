@@ -0,0 +1,39 @@
+#ifndef sprt_h
+#define sprt_h
+
+#include <string>
+#include <cstdint>
+#include <stdio.h>
+
+#define SPRT_CONTINUE 0
+#define SPRT_H0 1 //接受H0(玩家1比玩家2强elo0分)
+#define SPRT_H1 2 //接受H1(玩家1比玩家2强elo1分)
+#define SPRT_DEFAULT_MAX_PAIRS 1000 //没写sprt.max_pairs、也没有胜利阈值时最多下这么多对
+#define SPRT_MAX_WASTED 8 //连续这么多盘作废(或者开不了局)就不再下了
+
+//players.conf里的sprt.elo0=0, sprt.elo1=5, sprt.alpha=0.05, sprt.beta=0.05, sprt.max_pairs=1000, 出现任何一个就打开SPRT
+struct SPRTConfig{
+    bool enabled = false;
+    double elo0 = 0.0;
+    double elo1 = 5.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+    size_t max_pairs = 0; //顺序下棋时最多下几对, 0表示按胜利阈值(2 * 阈值 - 1盘), 阈值也是0时用SPRT_DEFAULT_MAX_PAIRS; match模式用命令行的pairs
+    double LowerBound() const; //log(beta / (1 - alpha))
+    double UpperBound() const; //log((1 - beta) / alpha)
+};
+
+//按对局对(同一开局红黑各一盘)统计玩家1的得分: 0, 0.5, 1, 1.5, 2分各多少对
+//一对里两盘的结果是相关的(同一个布局), 按对统计方差才不会低估
+struct Pentanomial{
+    uint64_t pairs[5] = {0, 0, 0, 0, 0};
+    void Add(int half_points); //这一对玩家1得了几个半分(0..4)
+    uint64_t Num() const;
+    double Score(double* variance) const; //玩家1每盘的平均得分, variance是每对平均分的方差
+    double Elo(double* error) const; //error是95%置信区间的半宽
+    double LLR(const SPRTConfig& config) const; //GSPRT的对数似然比(正态近似)
+    int Decide(const SPRTConfig& config) const;
+    std::string Report(const SPRTConfig& config) const;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "telemetry.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdlib.h>
+
+#define TELEMETRY_CSV_HEADER "engine,game,round,side,depth,nodes,qnodes,ms,nps,tt_probes,tt_hits,evals,score"
+
+static bool _is_json(const std::string& path){
+    auto ends_with = [&path](const std::string& suffix){
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    return ends_with(".json") || ends_with(".jsonl");
+}
+
+TelemetrySink::TelemetrySink(const std::string& path){
+    SetPath(path);
+}
+
+TelemetrySink::~TelemetrySink(){
+    Flush();
+    if(_file){
+        fclose(_file);
+    }
+}
+
+void TelemetrySink::SetPath(const std::string& path){
+    if(_file){
+        Flush();
+        fclose(_file);
+        _file = NULL;
+    }
+    _path = path;
+    _json = _is_json(path);
+    _ok = true;
+}
+
+void TelemetrySink::Append(const MoveTelemetry& move){
+    summary.Add(move);
+    _pending.push_back(move);
+    if(_pending.size() >= TELEMETRY_BUFFER_RECORDS){
+        Flush();
+    }
+}
+
+void TelemetrySink::Flush(){
+    if(_pending.empty()){
+        return;
+    }
+    if(!_ok){
+        _pending.clear(); //文件打不开, 记录只进汇总
+        return;
+    }
+    if(!_file){
+        _file = fopen(_path.c_str(), "w");
+        if(!_file){
+            printf("[FAILED 0]board --> telemetry.cpp --> Open %s FAILED!\n", _path.c_str());
+            _ok = false;
+            return;
+        }
+        if(!_json){
+            fprintf(_file, "%s\n", TELEMETRY_CSV_HEADER);
+        }
+    }
+    for(const MoveTelemetry& m : _pending){
+        const char* format = _json ? \
+            "{\"engine\":\"%s\",\"game\":%llu,\"round\":%d,\"side\":\"%s\",\"depth\":%d,\"nodes\":%llu,\"qnodes\":%llu,\"ms\":%zu,\"nps\":%.0f,\"tt_probes\":%llu,\"tt_hits\":%llu,\"evals\":%llu,\"score\":%d}\n" : \
+            "%s,%llu,%d,%s,%d,%llu,%llu,%zu,%.0f,%llu,%llu,%llu,%d\n";
+        fprintf(_file, format, m.engine.c_str(), (unsigned long long)m.game, m.round, m.red ? "red" : "black", m.depth, (unsigned long long)m.nodes, (unsigned long long)m.qnodes, \
+            m.ms, m.Nps(), (unsigned long long)m.tt_probes, (unsigned long long)m.tt_hits, (unsigned long long)m.evals, m.score);
+    }
+    fflush(_file);
+    _pending.clear();
+}
+
+//JSON lines只认TelemetrySink自己写的格式: "key":value, 字符串里没有引号
+static std::string _json_value(const std::string& line, const std::string& key){
+    const size_t at = line.find("\"" + key + "\":");
+    if(at == std::string::npos){
+        return "";
+    }
+    const size_t begin = at + key.size() + 3;
+    if(begin < line.size() && line[begin] == '"'){
+        const size_t end = line.find('"', begin + 1);
+        return end == std::string::npos ? "" : line.substr(begin + 1, end - begin - 1);
+    }
+    const size_t end = line.find_first_of(",}", begin);
+    return line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+bool ReadTelemetry(const std::string& path, TelemetrySummary* summary){
+    std::ifstream in(path);
+    if(!in.is_open()){
+        printf("[FAILED 0]board --> telemetry.cpp --> ReadTelemetry --> %s is NOT open!\n", path.c_str());
+        return false;
+    }
+    const bool json = _is_json(path);
+    const char* keys[] = {"engine", "game", "round", "side", "depth", "nodes", "qnodes", "ms", "nps", "tt_probes", "tt_hits", "evals", "score"};
+    std::string line;
+    while(std::getline(in, line)){
+        if(line.empty() || line == TELEMETRY_CSV_HEADER){
+            continue;
+        }
+        std::vector<std::string> fields;
+        if(json){
+            for(const char* key : keys){
+                fields.push_back(_json_value(line, key));
+            }
+        }else{
+            std::istringstream ss(line);
+            std::string field;
+            while(std::getline(ss, field, ',')){
+                fields.push_back(field);
+            }
+        }
+        if(fields.size() != sizeof(keys) / sizeof(keys[0])){
+            printf("[FAILED 1]board --> telemetry.cpp --> ReadTelemetry --> %s: 无法解析 %s\n", path.c_str(), line.c_str());
+            return false;
+        }
+        MoveTelemetry m;
+        m.engine = fields[0];
+        m.game = strtoull(fields[1].c_str(), NULL, 10);
+        m.round = atoi(fields[2].c_str());
+        m.red = fields[3] == "red";
+        m.depth = atoi(fields[4].c_str());
+        m.nodes = strtoull(fields[5].c_str(), NULL, 10);
+        m.qnodes = strtoull(fields[6].c_str(), NULL, 10);
+        m.ms = (size_t)strtoull(fields[7].c_str(), NULL, 10);
+        m.tt_probes = strtoull(fields[9].c_str(), NULL, 10);
+        m.tt_hits = strtoull(fields[10].c_str(), NULL, 10);
+        m.evals = strtoull(fields[11].c_str(), NULL, 10);
+        m.score = atoi(fields[12].c_str());
+        summary -> Add(m);
+    }
+    return true;
+}
+
+//v已经排好序, 最近秩法
+template<typename T>
+static T _percentile(const std::vector<T>& v, double p){
+    if(v.empty()){
+        return T();
+    }
+    size_t rank = (size_t)(p / 100.0 * v.size() + 0.999999);
+    rank = std::min(std::max(rank, (size_t)1), v.size());
+    return v[rank - 1];
+}
+
+void TelemetrySummary::Add(const MoveTelemetry& m){
+    EngineTelemetry& e = _engines[m.engine];
+    ++e.moves;
+    e.depth += m.depth;
+    e.nodes += m.nodes;
+    e.qnodes += m.qnodes;
+    e.tt_probes += m.tt_probes;
+    e.tt_hits += m.tt_hits;
+    e.evals += m.evals;
+    e.ms.push_back(m.ms);
+    if(m.ms){
+        e.nps.push_back(m.Nps());
+    }
+}
+
+void TelemetrySummary::Print(){
+    for(auto& it : _engines){
+        EngineTelemetry& e = it.second;
+        std::sort(e.ms.begin(), e.ms.end());
+        std::sort(e.nps.begin(), e.nps.end());
+        const size_t n = e.moves;
+        size_t total_ms = 0;
+        for(size_t t : e.ms){
+            total_ms += t;
+        }
+        printf("telemetry %s: %zu moves, depth %.2f, nodes/move %.0f (q %.1f%%), evals/move %.1f, TT hit %.1f%%\n", it.first.c_str(), n, (double)e.depth / n, (double)e.nodes / n, \
+            e.nodes ? 100.0 * e.qnodes / e.nodes : 0.0, (double)e.evals / n, e.tt_probes ? 100.0 * e.tt_hits / e.tt_probes : 0.0);
+        printf("    time ms: p50 %zu, p90 %zu, p99 %zu, max %zu; NPS: p10 %.0f, p50 %.0f, p90 %.0f, overall %.0f\n", _percentile(e.ms, 50), _percentile(e.ms, 90), _percentile(e.ms, 99), e.ms.back(), \
+            _percentile(e.nps, 10), _percentile(e.nps, 50), _percentile(e.nps, 90), total_ms ? e.nodes * 1000.0 / total_ms : 0.0);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef telemetry_h
+#define telemetry_h
+
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdint>
+#include <stdio.h>
+
+#define TELEMETRY_BUFFER_RECORDS 256 //攒够这么多步才真正写一次文件
+
+//每个引擎每走一步一条: 搜索深度、节点数、用时、置换表命中率、分数
+//engine是"AI<编号>"加上players.conf里的选项, 例如AI4{eval=nnue}, 同一个引擎换了红黑也是同一个名字
+struct MoveTelemetry{
+    std::string engine;
+    uint64_t game = 0; //这个God下的第几盘
+    int round = 0;
+    bool red = true;
+    int depth = 0;
+    uint64_t nodes = 0;
+    uint64_t qnodes = 0;
+    size_t ms = 0; //Think的墙上时间
+    uint64_t tt_probes = 0;
+    uint64_t tt_hits = 0;
+    uint64_t evals = 0;
+    int score = 0; //行棋方视角
+    double Nps() const{
+        return ms ? nodes * 1000.0 / ms : 0.0;
+    }
+};
+
+//按引擎汇总用的累计量: 计数器加上每步用时和NPS的样本(算分位数), 不留整条记录
+struct EngineTelemetry{
+    size_t moves = 0;
+    uint64_t depth = 0, nodes = 0, qnodes = 0, tt_probes = 0, tt_hits = 0, evals = 0;
+    std::vector<size_t> ms;
+    std::vector<double> nps; //不到1毫秒的步算不出NPS, 不记
+};
+
+class TelemetrySummary{
+public:
+    void Add(const MoveTelemetry& move);
+    bool empty() const{
+        return _engines.empty();
+    }
+    //按引擎打印: 每步用时的分位数、NPS的分布、平均深度、置换表命中率
+    void Print();
+private:
+    std::map<std::string, EngineTelemetry> _engines;
+};
+
+//players.conf里telemetry.file=path打开; 后缀是.json或.jsonl时每行一个JSON对象, 否则写CSV
+//文件在第一次写的时候才打开(截断), 并发对局的worker可以在fork之后再改路径
+class TelemetrySink{
+public:
+    explicit TelemetrySink(const std::string& path);
+    ~TelemetrySink();
+    void SetPath(const std::string& path);
+    const std::string& GetPath() const{
+        return _path;
+    }
+    bool ok() const{
+        return _ok;
+    }
+    void Append(const MoveTelemetry& move);
+    void Flush();
+    TelemetrySummary summary; //这个进程里记过的每一步都加进来, 退出时汇总用
+private:
+    std::string _path;
+    bool _json = false;
+    bool _ok = true;
+    FILE* _file = NULL;
+    std::vector<MoveTelemetry> _pending; //还没写进文件的, Flush以后清空
+};
+
+//读CSV或JSON lines, 格式和TelemetrySink写的一样, 每条加进summary
+bool ReadTelemetry(const std::string& path, TelemetrySummary* summary);
+
+#endif
@@ -3,13 +3,69 @@
 
 #include "../global/global.h"
 #include "../score/score.h"
+#include "../global/context.h"
+#include <cstdlib>
+
+#define SEARCH_MAX_DEPTH 20 //设了nodes或movetime而没设depth时, 迭代加深最多到这一层
+#define SEARCH_DEFAULT_MS 50000 //什么限制都没设时, 用时超过这么多毫秒就不再加深
 
 namespace board{
+    //players.conf里给这个玩家的搜索限制: player1.depth=8, player1.nodes=2000000, player1.movetime=5000(毫秒), 0表示不限
+    //depth和nodes只看搜索本身, 和机器快慢、负载无关, 设了其中任何一个就不再看墙上时间
+    //都在迭代加深的两层之间检查: 一层搜完才停, 不会丢掉搜了一半的结果
+    struct SearchLimits{
+        int depth = 0; //主搜索的深度, 不算静态搜索
+        uint64_t nodes = 0;
+        size_t movetime = 0;
+        int MaxDepth(int default_depth) const{
+            return depth > 0 ? depth : ((nodes || movetime) ? SEARCH_MAX_DEPTH : default_depth);
+        }
+        //迭代加深从哪一层开始: 按节点数或时间停时从1层开始, 不然第一层就可能远远超出限制
+        int MinDepth(int default_depth, int max_depth) const{
+            return (nodes || movetime) ? 1 : std::min(default_depth, max_depth);
+        }
+        //第done层搜完以后要不要停
+        bool Stop(int done, int max_depth, uint64_t searched, size_t ms) const{
+            if(done >= max_depth || (nodes && searched >= nodes)){
+                return true;
+            }
+            if(movetime){
+                return 2 * ms >= movetime; //下一层一般比前面几层加起来还慢, 用掉一半就不再加深
+            }
+            return depth == 0 && nodes == 0 && ms > SEARCH_DEFAULT_MS;
+        }
+    };
+
+
     struct Thinker{
         bool thinker_type; //true: Human, false: AI
         int retry_num;
         bool turn;
+        EngineContext* context = NULL; //PST、置换表、随机数都从这里拿, AIBoard构造时设好
+        std::unordered_map<std::string, std::string>* options = NULL; //players.conf里给这个玩家的选项(key=value)
+        short search_score = 0; //最近一次Think的搜索分数, 行棋方视角
+        int search_depth = 0; //最近一次Think的搜索深度, 0表示没有搜索(人, 开局库)
+        uint64_t search_nodes = 0; //最近一次Think搜过的节点数(主搜索 + 静态搜索)
+        uint64_t search_qnodes = 0; //其中静态搜索的节点数
+        uint64_t tt_probes = 0; //查置换表(tp_score)的次数
+        uint64_t tt_hits = 0;
+        uint64_t eval_calls = 0; //eval4(暗子展开的评估)调用次数, 只有AI4有
+        SearchLimits limits;
         virtual std::string Think() = 0;
+        //AIBoard每步都新建, 每步Think之前从options里读一次; 格式在God::ParseOption里检查过
+        void ReadLimits(){
+            limits = SearchLimits();
+            if(!options){
+                return;
+            }
+            auto get = [this](const char* key) -> uint64_t {
+                auto it = options -> find(key);
+                return it == options -> end() ? 0 : strtoull(it -> second.c_str(), NULL, 10);
+            };
+            limits.depth = (int)get("depth");
+            limits.nodes = get("nodes");
+            limits.movetime = (size_t)get("movetime");
+        }
     };
 }
 
@@ -0,0 +1,23 @@
+#include "context.h"
+
+extern short pstglobal[5][PIECE_SLOTS][SQUARE_SLOTS];
+extern uint32_t zobrist_table[SYMBOL_NUM][SQUARE_SLOTS];
+
+EngineContext::EngineContext(): EngineContext((uint32_t)rand()){
+}
+
+EngineContext::EngineContext(uint32_t seed): zobrist(::zobrist_table), rng(seed){
+    memcpy(pst, ::pstglobal, sizeof(pst));
+}
+
+void EngineContext::ClearTables(){
+    tp_move_bean.clear();
+    tp_score_bean.clear();
+    eval_cache_bean.clear();
+}
+
+EngineContext* DefaultContext(){
+    //第一次用到时才拷pstglobal, 这时main已经读完score.conf
+    static EngineContext context;
+    return &context;
+}
@@ -0,0 +1,39 @@
+#ifndef context_h
+#define context_h
+
+#include <unordered_map>
+#include <random>
+#include <cstdint>
+#include "global.h"
+#include "../score/score.h"
+
+//tp_move: (zobrist_key, turn) --> move
+typedef std::unordered_map<std::pair<uint32_t, bool>, std::pair<unsigned char, unsigned char>, myhash<uint32_t, bool>> TP_MOVE;
+//tp_score: (zobrist_key, turn, depth <depth * 2 + turn>) --> (lower, upper)
+typedef std::unordered_map<std::pair<uint32_t, int>, std::pair<short, short>, myhash<uint32_t, int>> TP_SCORE;
+
+//一套引擎的全部可变状态: PST、置换表、静态评估缓存、随机数
+//原来是pstglobal, tp_move_bean, tp_score_bean, eval_cache_bean和rand(), 一个进程里只能有一个搜索
+//每个God(一局棋)一个, 不同线程用不同的EngineContext就互不干扰
+//L1, zobrist_table初始化以后只读; 各个bean(注册表)在静态初始化时填好以后也只读, 都还是全局的
+struct EngineContext{
+    short pst[5][PIECE_SLOTS][SQUARE_SLOTS]; //构造时从pstglobal拷一份
+    const uint32_t (*zobrist)[SQUARE_SLOTS]; //指向zobrist_table
+    //key是AI编号, 和原来的全局bean一样: 同一个context里同一种AI共用置换表
+    std::unordered_map<int, TP_MOVE> tp_move_bean;
+    std::unordered_map<int, TP_SCORE> tp_score_bean;
+    std::unordered_map<int, EvalCache> eval_cache_bean;
+    std::mt19937 rng;
+    EngineContext();
+    explicit EngineContext(uint32_t seed);
+    EngineContext(const EngineContext&) = delete;
+    void ClearTables(); //新开一局时清置换表和评估缓存
+    int Random(int n){
+        return (int)(rng() % (uint32_t)n);
+    }
+};
+
+//没有指定EngineContext时用的那一个(只给单线程的老代码用)
+EngineContext* DefaultContext();
+
+#endif
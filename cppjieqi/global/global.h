@@ -11,6 +11,9 @@
 #include <functional>
 #include <iostream>
 #include <type_traits>
+#include <atomic>
+#include <memory>
+#include <cstdint>
 
 namespace board{
    struct Thinker;
@@ -140,4 +143,35 @@ struct InfoDict{
    ~InfoDict()=default;
 };
 
+//静态评估缓存: 每个entry是一个64位字, 读写都是单条原子操作, 多线程也不用加锁
+//entry = 1(有效位) | (zobrist << 1 | turn) << 16 | value
+class EvalCache{
+public:
+   static constexpr size_t SIZE = 1 << 18;
+   EvalCache(): table(new std::atomic<uint64_t>[SIZE]){
+      clear();
+   }
+   void clear(){
+      for(size_t i = 0; i < SIZE; ++i){
+         table[i].store(0, std::memory_order_relaxed);
+      }
+   }
+   bool probe(uint32_t key, bool turn, short* value) const{
+      uint64_t entry = table[key & (SIZE - 1)].load(std::memory_order_relaxed);
+      if(entry != _pack(key, turn, (uint16_t)entry)){
+         return false;
+      }
+      *value = (short)(uint16_t)entry;
+      return true;
+   }
+   void store(uint32_t key, bool turn, short value){
+      table[key & (SIZE - 1)].store(_pack(key, turn, (uint16_t)value), std::memory_order_relaxed);
+   }
+private:
+   std::unique_ptr<std::atomic<uint64_t>[]> table;
+   static uint64_t _pack(uint32_t key, bool turn, uint16_t value){
+      return (1ULL << 63) | (((uint64_t)key << 1 | turn) << 16) | value;
+   }
+};
+
 #endif
@@ -5,20 +5,59 @@
 #include "global/global.h"
 #include "board/god.h"
 #include "score/score.h"
+#include "board/aiboard4.h"
+#include "board/match.h"
+#include "board/bench.h"
+#include "board/perft.h"
 
-extern bool read_score_table(const char* score_file, short pst[][256]);
-extern void copy_pst(short dst[][256], short src[][256]);
+extern bool read_score_table(const char* score_file, short pst[][SQUARE_SLOTS]);
 extern void IntializeL1();
-extern short pstglobal[5][123][256];
-extern unsigned char L1[256][256];
+extern void IntializeZobrist();
+extern short pstglobal[5][PIECE_SLOTS][SQUARE_SLOTS];
+extern unsigned char L1[SQUARE_SLOTS][SQUARE_SLOTS];
 
-int main(void) {
+int main(int argc, char* argv[]) {
     srand(time(NULL));
     IntializeL1();
+    IntializeZobrist();
     memset(pstglobal, 0, sizeof(pstglobal));
     assert(read_score_table("../score.conf", pstglobal[2]));
     assert(read_score_table("../score.conf", pstglobal[3]));
     assert(read_score_table("../score.conf", pstglobal[4]));
+    if(argc > 1 && strcmp(argv[1], "movegen") == 0){
+        //./cppjieqi movegen [depth]: 带分数的走法生成的benchmark
+        board::Board b;
+        bench_movegen4(b.state_red, b.di_red, argc > 2 ? atoi(argv[2]) : 3);
+        return 0;
+    }
+    if(argc > 1 && strcmp(argv[1], "bench") == 0){
+        //./cppjieqi bench [depth]: AI3, AI4, AI5在固定的局面集上搜到固定深度, 看节点数、NPS和签名
+        return RunBench(argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_DEPTH) ? 0 : 1;
+    }
+    if(argc > 1 && strcmp(argv[1], "perft") == 0){
+        //./cppjieqi perft [depth] [threads] [fen...]: 带暗子的perft, 裁判和AI4的走法生成逐个着法对拍
+        return RunPerft(argc > 2 ? atoi(argv[2]) : PERFT_DEFAULT_DEPTH, argc > 3 ? atoi(argv[3]) : 0, std::vector<std::string>(argv + std::min(argc, 4), argv + argc));
+    }
+    if(argc > 1 && strcmp(argv[1], "datagen") == 0){
+        //./cppjieqi datagen [games] [workers] [prefix]: 按players.conf自对弈, 写训练数据
+        return RunDataGen("../players.conf", argc > 2 ? atoi(argv[2]) : 100, argc > 3 ? atoi(argv[3]) : 1, argc > 4 ? argv[4] : "selfplay");
+    }
+    if(argc > 1 && strcmp(argv[1], "match") == 0){
+        //./cppjieqi match [pairs] [workers]: 多进程并发对局, 每个开局红黑各下一盘
+        RunMatch("../players.conf", argc > 2 ? atoi(argv[2]) : 50, argc > 3 ? atoi(argv[3]) : 0);
+        return 0;
+    }
+    if(argc > 1 && strcmp(argv[1], "telemetry") == 0){
+        //./cppjieqi telemetry file...: 汇总一个或几个telemetry文件(CSV或JSON lines), 比较两个版本的速度
+        TelemetrySummary summary;
+        for(int i = 2; i < argc; ++i){
+            if(!ReadTelemetry(argv[i], &summary)){
+                return 1;
+            }
+        }
+        summary.Print();
+        return 0;
+    }
     God g("../players.conf");
     DEBUG ? g.StartGame() : g.StartGameLoopAlternatively();
     #if !DEBUG
@@ -0,0 +1,199 @@
+#include "nnue.h"
+#include <mutex>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NNUE_X86 1
+#include <immintrin.h>
+#else
+#define NNUE_X86 0
+#endif
+
+extern std::unordered_map<std::string, std::unique_ptr<NNUE>> nnue_bean; //define in ../global/global.cpp
+
+//clipped relu: 两个int16累加器相加后截到[0, 127], 存成uint8
+typedef void(*NNUE_TRANSFORM)(const int16_t* acc, const int16_t* pool, uint8_t* out, int n);
+//out[r] = sum(input[c] * weight[r][c]), input是uint8, weight是int8
+typedef void(*NNUE_AFFINE)(const uint8_t* input, const int8_t* weight, int rows, int cols, int32_t* out);
+
+static void _transform_scalar(const int16_t* acc, const int16_t* pool, uint8_t* out, int n){
+    for(int i = 0; i < n; ++i){
+        const int v = acc[i] + pool[i];
+        out[i] = v < 0 ? 0 : (v > 127 ? 127 : v);
+    }
+}
+
+static void _affine_scalar(const uint8_t* input, const int8_t* weight, int rows, int cols, int32_t* out){
+    for(int r = 0; r < rows; ++r){
+        int32_t sum = 0;
+        for(int c = 0; c < cols; ++c){
+            sum += input[c] * weight[r * cols + c];
+        }
+        out[r] = sum;
+    }
+}
+
+#if NNUE_X86
+//maddubs的两两相加不会溢出int16: 2 * 127 * 128 < 32768
+__attribute__((target("ssse3"))) static void _transform_ssse3(const int16_t* acc, const int16_t* pool, uint8_t* out, int n){
+    const __m128i top = _mm_set1_epi8(127);
+    for(int i = 0; i < n; i += 16){
+        const __m128i s0 = _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(acc + i)), _mm_loadu_si128((const __m128i*)(pool + i)));
+        const __m128i s1 = _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(acc + i + 8)), _mm_loadu_si128((const __m128i*)(pool + i + 8)));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_min_epu8(_mm_packus_epi16(s0, s1), top));
+    }
+}
+
+__attribute__((target("ssse3"))) static void _affine_ssse3(const uint8_t* input, const int8_t* weight, int rows, int cols, int32_t* out){
+    const __m128i ones = _mm_set1_epi16(1);
+    for(int r = 0; r < rows; ++r){
+        const int8_t* row = weight + r * cols;
+        __m128i sum = _mm_setzero_si128();
+        for(int c = 0; c < cols; c += 16){
+            const __m128i x = _mm_loadu_si128((const __m128i*)(input + c));
+            const __m128i w = _mm_loadu_si128((const __m128i*)(row + c));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        out[r] = _mm_cvtsi128_si32(sum);
+    }
+}
+
+__attribute__((target("avx2"))) static void _transform_avx2(const int16_t* acc, const int16_t* pool, uint8_t* out, int n){
+    const __m256i top = _mm256_set1_epi8(127);
+    for(int i = 0; i < n; i += 32){
+        const __m256i s0 = _mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)(acc + i)), _mm256_loadu_si256((const __m256i*)(pool + i)));
+        const __m256i s1 = _mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)(acc + i + 16)), _mm256_loadu_si256((const __m256i*)(pool + i + 16)));
+        //packus按128位分别打包, 要把中间两段换回来
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(s0, s1), 0xD8);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_min_epu8(packed, top));
+    }
+}
+
+__attribute__((target("avx2"))) static void _affine_avx2(const uint8_t* input, const int8_t* weight, int rows, int cols, int32_t* out){
+    const __m256i ones = _mm256_set1_epi16(1);
+    for(int r = 0; r < rows; ++r){
+        const int8_t* row = weight + r * cols;
+        __m256i sum = _mm256_setzero_si256();
+        for(int c = 0; c < cols; c += 32){
+            const __m256i x = _mm256_loadu_si256((const __m256i*)(input + c));
+            const __m256i w = _mm256_loadu_si256((const __m256i*)(row + c));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        out[r] = _mm_cvtsi128_si32(s);
+    }
+}
+#endif
+
+//运行时按CPU选实现, 编译时不用加-mavx2
+static NNUE_TRANSFORM _transform = _transform_scalar;
+static NNUE_AFFINE _affine = _affine_scalar;
+
+static const char* _select_kernels(){
+    #if NNUE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        _transform = _transform_avx2;
+        _affine = _affine_avx2;
+        return "avx2";
+    }
+    if(__builtin_cpu_supports("ssse3")){
+        _transform = _transform_ssse3;
+        _affine = _affine_ssse3;
+        return "ssse3";
+    }
+    #endif
+    return "scalar";
+}
+
+bool NNUE::Load(const char* nnue_file){
+    std::ifstream instream(nnue_file, std::ios::binary);
+    if(!instream.is_open()){
+        printf("[FAILED 0]score --> nnue.cpp --> Load --> Open %s FAILED!\n", nnue_file);
+        return false;
+    }
+    char magic[4] = {0};
+    uint32_t header[4] = {0};
+    instream.read(magic, sizeof(magic));
+    instream.read(reinterpret_cast<char*>(header), sizeof(header));
+    if(!instream || memcmp(magic, NNUE_MAGIC, sizeof(magic)) != 0 || header[0] != NNUE_VERSION){
+        printf("[FAILED 1]score --> nnue.cpp --> Load --> %s is not a version %d NNUE file!\n", nnue_file, NNUE_VERSION);
+        return false;
+    }
+    if(header[1] != FEATURES || header[2] != HIDDEN || header[3] != L1){
+        printf("[FAILED 2]score --> nnue.cpp --> Load --> Shape mismatch! file = (%u, %u, %u), expected = (%d, %d, %d)\n", header[1], header[2], header[3], FEATURES, HIDDEN, L1);
+        return false;
+    }
+    instream.read(reinterpret_cast<char*>(ft_bias), sizeof(ft_bias));
+    instream.read(reinterpret_cast<char*>(ft_weight), sizeof(ft_weight));
+    instream.read(reinterpret_cast<char*>(l1_bias), sizeof(l1_bias));
+    instream.read(reinterpret_cast<char*>(l1_weight), sizeof(l1_weight));
+    instream.read(reinterpret_cast<char*>(&l2_bias), sizeof(l2_bias));
+    instream.read(reinterpret_cast<char*>(l2_weight), sizeof(l2_weight));
+    if(!instream){
+        printf("[FAILED 3]score --> nnue.cpp --> Load --> %s is truncated!\n", nnue_file);
+        return false;
+    }
+    return true;
+}
+
+void NNUE::RefreshPieces(const char* view, int16_t* acc) const{
+    memcpy(acc, ft_bias, sizeof(ft_bias));
+    for(int i = 51; i <= 203; ++i){
+        if((i & 15) < 3 || (i & 15) > 11) { continue; }
+        const int feature = PieceFeature(view[i], i);
+        if(feature >= 0){
+            AddFeature(acc, feature);
+        }
+    }
+}
+
+void NNUE::RefreshPool(const unsigned char di[2][123], int side, int16_t* acc) const{
+    memset(acc, 0, sizeof(int16_t) * HIDDEN);
+    for(int s = 0; s < 2; ++s){
+        for(const char upper : MINGZI){
+            const char c = s ? upper : upper ^ 32;
+            const int num = std::min<int>(di[s][(int)c], nnue_pool_id.most[(int)c]);
+            for(int k = 1; k <= num; ++k){
+                AddFeature(acc, PoolFeature(s == side, c, k));
+            }
+        }
+    }
+}
+
+short NNUE::Forward(const int16_t* us, const int16_t* pool_us, const int16_t* them, const int16_t* pool_them) const{
+    alignas(32) uint8_t input[2 * HIDDEN];
+    alignas(32) int32_t hidden[L1];
+    alignas(32) uint8_t activated[L1];
+    _transform(us, pool_us, input, HIDDEN);
+    _transform(them, pool_them, input + HIDDEN, HIDDEN);
+    _affine(input, &l1_weight[0][0], L1, 2 * HIDDEN, hidden);
+    int32_t output = l2_bias;
+    for(int i = 0; i < L1; ++i){
+        const int32_t v = (hidden[i] + l1_bias[i]) >> NNUE_WEIGHT_SHIFT;
+        activated[i] = v < 0 ? 0 : (v > 127 ? 127 : v);
+        output += activated[i] * l2_weight[i];
+    }
+    output >>= NNUE_OUTPUT_SHIFT;
+    return (short)std::max(-NNUE_SCORE_LIMIT, std::min(NNUE_SCORE_LIMIT, output));
+}
+
+const NNUE* GetNNUE(const std::string& nnue_file){
+    //网络读进来以后只读, 几个线程可以共用; 只有查找/插入nnue_bean要加锁
+    static std::mutex nnue_mutex;
+    std::lock_guard<std::mutex> lock(nnue_mutex);
+    auto it = nnue_bean.find(nnue_file);
+    if(it != nnue_bean.end()){
+        return it -> second.get();
+    }
+    //读失败也记下来(NULL), 每步都会新建AIBoard, 不要每步都重新读一遍
+    std::unique_ptr<NNUE> network(new (std::nothrow) NNUE);
+    if(!network || !network -> Load(nnue_file.c_str())){
+        network.reset();
+    }else{
+        printf("NNUE %s loaded, kernel = %s\n", nnue_file.c_str(), _select_kernels());
+    }
+    return (nnue_bean[nnue_file] = std::move(network)).get();
+}
@@ -0,0 +1,110 @@
+#ifndef nnue_h
+#define nnue_h
+
+#include <memory>
+#include <string>
+#include <cstdint>
+#include "score.h"
+
+//可增量更新的神经网络评估(NNUE), 只用CPU
+//输入: 两个视角各自的稀疏特征, 视角里大写是己方
+//  棋子特征: 18种(己方RNBAKCP + 暗子 + 翻开未知的U, 对方同样) x 90格
+//  暗子池特征: aidi里剩余的暗子数, 温度计编码(剩余>=k), 己方15个, 对方15个
+//结构: FEATURES -> HIDDEN(int16累加器, 两个视角) -> clipped relu拼接成2*HIDDEN(uint8) -> L1(int8权重) -> 1
+//权重文件(小端): "JQNN", uint32版本号, uint32 FEATURES, HIDDEN, L1, 然后依次是
+//  int16 ft_bias[HIDDEN], int16 ft_weight[FEATURES][HIDDEN], int32 l1_bias[L1], int8 l1_weight[L1][2*HIDDEN], int32 l2_bias, int8 l2_weight[L1]
+#define NNUE_MAGIC "JQNN"
+#define NNUE_VERSION 1
+#define NNUE_WEIGHT_SHIFT 6 //int8权重的定点位数, 64表示1.0
+#define NNUE_OUTPUT_SHIFT 4 //输出层的和右移这么多位就是局面分
+#define NNUE_SCORE_LIMIT 2000 //留出杀棋分(MATE_UPPER = 2600)的空间
+
+struct NNUEPieceIndex{
+    unsigned char id[128];
+    constexpr NNUEPieceIndex(): id(){
+        const char pieces[] = "RNBAKCP";
+        for(int i = 0; i < 128; ++i){
+            id[i] = 255;
+        }
+        for(int i = 0; i < 7; ++i){
+            id[(int)pieces[i]] = i;
+            id[(int)pieces[i] ^ 32] = i + 9;
+        }
+        for(char c = 'D'; c <= 'I'; ++c){
+            id[(int)c] = 7;
+            id[(int)c ^ 32] = 16;
+        }
+        id[(int)'U'] = 8;
+        id[(int)'u'] = 17;
+    }
+};
+
+//暗子池特征在15个里的起始位置和最多个数, 帅不会在暗子里
+struct NNUEPoolIndex{
+    unsigned char offset[128];
+    unsigned char most[128];
+    constexpr NNUEPoolIndex(): offset(), most(){
+        const char pieces[] = "RNBACP";
+        const unsigned char counts[] = {2, 2, 2, 2, 2, 5};
+        unsigned char now = 0;
+        for(int i = 0; i < 128; ++i){
+            offset[i] = most[i] = 0;
+        }
+        for(int i = 0; i < 6; ++i){
+            offset[(int)pieces[i]] = offset[(int)pieces[i] ^ 32] = now;
+            most[(int)pieces[i]] = most[(int)pieces[i] ^ 32] = counts[i];
+            now += counts[i];
+        }
+    }
+};
+
+inline constexpr NNUEPieceIndex nnue_piece_id{};
+inline constexpr NNUEPoolIndex nnue_pool_id{};
+
+struct NNUE{
+    static constexpr int PIECE_TYPES = 18;
+    static constexpr int POOL_FEATURES = 15;
+    static constexpr int FEATURES = PIECE_TYPES * SQUARE_NUM + 2 * POOL_FEATURES;
+    static constexpr int HIDDEN = 128;
+    static constexpr int L1 = 32;
+    alignas(32) int16_t ft_bias[HIDDEN];
+    alignas(32) int16_t ft_weight[FEATURES][HIDDEN];
+    alignas(32) int8_t l1_weight[L1][2 * HIDDEN];
+    int32_t l1_bias[L1];
+    alignas(32) int8_t l2_weight[L1];
+    int32_t l2_bias;
+
+    bool Load(const char* nnue_file);
+    //view是该视角下的棋盘(state_red或state_black), 返回-1表示这个格子没有特征
+    static int PieceFeature(char c, int pos){
+        const unsigned char type = nnue_piece_id.id[(int)c];
+        return type == 255 ? -1 : type * SQUARE_NUM + SQ(pos);
+    }
+    //暗子池里c还剩>=k个(k从1开始), own表示是不是该视角的己方
+    static int PoolFeature(bool own, char c, int k){
+        return PIECE_TYPES * SQUARE_NUM + (own ? 0 : POOL_FEATURES) + nnue_pool_id.offset[(int)c] + k - 1;
+    }
+    void AddFeature(int16_t* acc, int feature) const{
+        const int16_t* row = ft_weight[feature];
+        for(int i = 0; i < HIDDEN; ++i){
+            acc[i] += row[i];
+        }
+    }
+    void SubFeature(int16_t* acc, int feature) const{
+        const int16_t* row = ft_weight[feature];
+        for(int i = 0; i < HIDDEN; ++i){
+            acc[i] -= row[i];
+        }
+    }
+    //从头算一个视角的棋子累加器(含bias)
+    void RefreshPieces(const char* view, int16_t* acc) const;
+    //从头算一个视角的暗子池累加器(不含bias), di是aidi[ver], side是该视角(1红0黑)
+    void RefreshPool(const unsigned char di[2][123], int side, int16_t* acc) const;
+    //us/them: 行棋方和对方的棋子累加器, pool_us/pool_them: 对应的暗子池累加器
+    short Forward(const int16_t* us, const int16_t* pool_us, const int16_t* them, const int16_t* pool_them) const;
+};
+
+//按文件名加载一次, 之后所有AIBoard共享; 读取失败返回NULL
+const NNUE* GetNNUE(const std::string& nnue_file);
+
+#endif
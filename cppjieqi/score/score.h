@@ -11,6 +11,8 @@
 #include <string>
 #include <string_view>
 #include <regex>
+#include <random>
+#include <cstdint>
 #include <stdio.h>
 #include <string.h>
 #include "../global/global.h"
@@ -26,8 +28,19 @@
 #define INTa (int)'a'
 #define INTc (int)'c'
 #define INTp (int)'p'
-#define RETURN memset(pst, 0, 123*256); return false;
+#define RETURN memset(pst, 0, sizeof(short) * PIECE_SLOTS * SQUARE_SLOTS); return false;
 #define ENCODE(x, y) ((16 * (x)) + (y) + 51)
+//紧凑下标: 棋子0..13(RNBAKCP, rnbakcp), 格子0..89(a9=0, i0=89)
+//引擎内部仍用16x16的mailbox和ASCII棋子, 只在查表时通过PID/SID/SQ转换
+#define PIECE_NUM 14
+#define SQUARE_NUM 90
+#define SYMBOL_NUM 29 //'.', 14种明子, 12种暗子, U, u
+#define PIECE_SLOTS (PIECE_NUM + 1) //最后一行全0, 非棋子字符都映射到这里
+#define SQUARE_SLOTS (SQUARE_NUM + 1) //最后一列: pst里存均值(原来的[c][0]), 棋盘外的格子也映射到这里
+#define AVERAGE_SLOT SQUARE_NUM
+#define PID(c) piece_id.id[(int)(c)]
+#define SID(c) symbol_id.id[(int)(c)]
+#define SQ(pos) square_id.id[(pos)]
 #define VERSION_MAX 2
 #define SUM(VERSION) \
 short numr = 0, numb = 0; \
@@ -36,9 +49,50 @@ numb += di[VERSION][0][INTr]; numb += di[VERSION][0][INTn];  numb += di[VERSION]
 sumall[VERSION][1] = numr; sumall[VERSION][0] = numb;
 
 const std::string MINGZI = "RNBAKCP";
-bool read_score_table(const char* score_file, short pst[][256]);
-void copy_pst(short dst[][256], short src[][256]);
+
+struct PieceIndex{
+    unsigned char id[128];
+    constexpr PieceIndex(): id(){
+        const char pieces[] = "RNBAKCPrnbakcp";
+        for(int i = 0; i < 128; ++i){
+            id[i] = PIECE_NUM;
+        }
+        for(int i = 0; i < PIECE_NUM; ++i){
+            id[(int)pieces[i]] = i;
+        }
+    }
+};
+
+struct SymbolIndex{
+    unsigned char id[128];
+    constexpr SymbolIndex(): id(){
+        const char symbols[] = ".RNBAKCPrnbakcpDEFGHIdefghiUu";
+        for(int i = 0; i < 128; ++i){
+            id[i] = 0;
+        }
+        for(int i = 0; i < SYMBOL_NUM; ++i){
+            id[(int)symbols[i]] = i;
+        }
+    }
+};
+
+struct SquareIndex{
+    unsigned char id[256];
+    constexpr SquareIndex(): id(){
+        for(int i = 0; i < 256; ++i){
+            int x = (i >> 4) - 3, y = (i & 15) - 3;
+            id[i] = (x >= 0 && x < 10 && y >= 0 && y < 9) ? 9 * x + y : SQUARE_NUM;
+        }
+    }
+};
+
+inline constexpr PieceIndex piece_id{};
+inline constexpr SymbolIndex symbol_id{};
+inline constexpr SquareIndex square_id{};
+
+bool read_score_table(const char* score_file, short pst[][SQUARE_SLOTS]);
 bool read_kaijuku(const char* kaijuku_file, std::unordered_map<std::string, std::pair<unsigned char, unsigned char>>& kaijuku);
 void IntializeL1();
+void IntializeZobrist();
 
 #endif
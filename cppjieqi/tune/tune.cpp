@@ -0,0 +1,378 @@
+// Texel式的PST调参: 读datagen生成的数据, 用AI4的静态评估+Quiescence挑出安静局面,
+// 多线程梯度下降最小化logistic loss, 最后按score.conf的格式写出新表
+#include <stdio.h>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include "../global/global.h"
+#include "../score/score.h"
+#include "../board/aiboard4.h"
+#include "../board/datagen.h"
+
+extern bool read_score_table(const char* score_file, short pst[][SQUARE_SLOTS]);
+extern void IntializeL1();
+extern void IntializeZobrist();
+extern short pstglobal[5][PIECE_SLOTS][SQUARE_SLOTS];
+
+#define TUNE_PIECES "RNBACP" //帅不调, 杀棋分和帅的分值绑在一起
+#define TUNE_PIECE_NUM 6
+#define TUNE_DARK 7 //entry里的piece = 7表示暗子
+
+//一个局面里一个子的贡献: sq(7位) | piece(3位) << 7 | 对方(1位) << 10, 格子都是该子自己视角的下标
+typedef uint16_t TuneEntry;
+
+struct TunePosition{
+    float target; //行棋方视角: 1胜, 0.5和, 0负
+    float constant; //和PST无关的部分: 帅, 空头炮, 护卫
+    float pool[2][TUNE_PIECE_NUM]; //[0]己方[1]对方的暗子池比例, 暗子按池里的平均值算
+    uint32_t first; //在entries里的起始位置
+    uint16_t count;
+};
+
+struct TuneOptions{
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int epochs = 200;
+    double lr = 1.0; //Adam每步每个格子最多动这么多分
+    int margin = 60; //|Quiescence - 静态评估| 超过这个就不算安静局面
+    int quiesc_depth = 1;
+    std::string input = "../score.conf";
+    std::string output = "score.tuned.conf";
+    std::vector<std::string> files;
+};
+
+struct TuneData{
+    std::vector<TunePosition> positions;
+    std::vector<TuneEntry> entries;
+};
+
+static const char symbols[] = ".RNBAKCPrnbakcpDEFGHIdefghiUu";
+
+//把记录还原成行棋方视角的256字节棋盘和AIBoard4用的暗子池
+static void _decode_record(const DataRecord& record, char state[MAX], unsigned char di[VERSION_MAX][2][123]){
+    memset(state, ' ', CHESS_BOARD_SIZE);
+    memset(state + CHESS_BOARD_SIZE, 0, MAX - CHESS_BOARD_SIZE);
+    for(int x = 0; x < 10; ++x){
+        for(int y = 0; y < 9; ++y){
+            state[ENCODE(x, y)] = symbols[record.board[9 * x + y] % SYMBOL_NUM];
+        }
+    }
+    if(!record.turn){
+        std::reverse(state, state + 255);
+        std::transform(state, state + 255, state, [](char c) -> char {return isalpha(c) ? c ^ 32 : c;});
+    }
+    memset(di, 0, sizeof(unsigned char) * VERSION_MAX * 2 * 123);
+    for(int v = 0; v < VERSION_MAX; ++v){
+        for(int k = 0; k < TUNE_PIECE_NUM; ++k){
+            di[v][1][(int)TUNE_PIECES[k]] = record.pool[1][k];
+            di[v][0][TUNE_PIECES[k] ^ 32] = record.pool[0][k];
+        }
+    }
+}
+
+static int _tune_piece(char upper){
+    const char* p = strchr(TUNE_PIECES, upper);
+    return p ? (int)(p - TUNE_PIECES) : -1;
+}
+
+//用AI4判断是否安静, 是的话把局面拆成entries
+static bool _prepare(const DataRecord& record, const TuneOptions& opt, EngineContext* context, TunePosition* position, std::vector<TuneEntry>& entries){
+    char state[MAX];
+    unsigned char di[VERSION_MAX][2][123];
+    _decode_record(record, state, di);
+    std::unordered_map<std::string, bool> hist;
+    //每个线程一个EngineContext, 置换表不共享
+    std::unique_ptr<board::AIBoard4> ai(new board::AIBoard4(state, record.turn, std::max<int>(1, record.round), di, 0, &hist, context));
+    //score是相对根节点的, 换局面就要清空置换表; 评估缓存和路径无关, 留着
+    ai -> tp_move -> clear();
+    ai -> tp_score -> clear();
+    const short positional = ai -> kongtoupao_score - ai -> kongtoupao_score_opponent + ai -> ScanProtectors();
+    int me = 0, op = 0;
+    const short upper = positional + opt.margin + 1;
+    if(mtd_quiescence4(ai.get(), upper, opt.quiesc_depth, true, &me, &op) >= upper){
+        return false;
+    }
+    const short lower = positional - opt.margin;
+    if(mtd_quiescence4(ai.get(), lower, opt.quiesc_depth, true, &me, &op) < lower){
+        return false;
+    }
+    const char* view = ai -> getstatepointer();
+    const int own = record.turn ? 1 : 0;
+    int num[2] = {0, 0};
+    for(int k = 0; k < TUNE_PIECE_NUM; ++k){
+        num[0] += record.pool[own][k];
+        num[1] += record.pool[1 - own][k];
+    }
+    for(int k = 0; k < TUNE_PIECE_NUM; ++k){
+        position -> pool[0][k] = num[0] ? (float)record.pool[own][k] / num[0] : 0.0f;
+        position -> pool[1][k] = num[1] ? (float)record.pool[1 - own][k] / num[1] : 0.0f;
+    }
+    const int result = record.turn ? record.result : -record.result;
+    position -> target = 0.5f * (result + 1);
+    position -> constant = positional;
+    position -> first = entries.size();
+    for(int i = 51; i <= 203; ++i){
+        if((i & 15) < 3 || (i & 15) > 11) { continue; }
+        const char c = view[i];
+        if(c == '.'){
+            continue;
+        }
+        const bool opponent = islower(c);
+        const int sq = opponent ? SQ(254 - i) : SQ(i);
+        const char upper = toupper(c);
+        if(upper == 'K'){
+            position -> constant += (opponent ? -1 : 1) * pstglobal[3][PID('K')][sq];
+            continue;
+        }
+        const int piece = (upper >= 'D' && upper <= 'I') ? TUNE_DARK : _tune_piece(upper);
+        if(piece < 0){
+            continue;
+        }
+        entries.push_back(sq | piece << 7 | (opponent ? 1 : 0) << 10);
+    }
+    position -> count = entries.size() - position -> first;
+    return true;
+}
+
+static bool _load(const TuneOptions& opt, TuneData& data){
+    std::vector<DataRecord> records;
+    for(const std::string& file : opt.files){
+        std::ifstream in(file, std::ios::binary | std::ios::ate);
+        if(!in.is_open()){
+            printf("[FAILED 0]tune --> tune.cpp --> Open %s FAILED!\n", file.c_str());
+            return false;
+        }
+        const size_t num = (size_t)in.tellg() / sizeof(DataRecord);
+        in.seekg(0);
+        const size_t before = records.size();
+        records.resize(before + num);
+        in.read(reinterpret_cast<char*>(records.data() + before), num * sizeof(DataRecord));
+    }
+    printf("records = %zu\n", records.size());
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<TuneData> parts(opt.threads);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < opt.threads; ++t){
+        workers.emplace_back([&, t](){
+            EngineContext context;
+            TuneData& part = parts[t];
+            for(size_t i = t; i < records.size(); i += opt.threads){
+                TunePosition position;
+                const size_t mark = part.entries.size();
+                if(_prepare(records[i], opt, &context, &position, part.entries)){
+                    part.positions.push_back(position);
+                }else{
+                    part.entries.resize(mark);
+                }
+            }
+        });
+    }
+    for(std::thread& worker : workers){
+        worker.join();
+    }
+    for(TuneData& part : parts){
+        const uint32_t offset = data.entries.size();
+        for(TunePosition& position : part.positions){
+            position.first += offset;
+            data.positions.push_back(position);
+        }
+        data.entries.insert(data.entries.end(), part.entries.begin(), part.entries.end());
+    }
+    size_t ms = (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    printf("quiet positions = %zu / %zu, prepare = %zu ms\n", data.positions.size(), records.size(), ms);
+    return !data.positions.empty();
+}
+
+static inline double _evaluate(const TunePosition& position, const TuneEntry* entries, const double* theta){
+    double e = position.constant;
+    for(int j = 0; j < position.count; ++j){
+        const int sq = entries[j] & 127, piece = (entries[j] >> 7) & 7, side = entries[j] >> 10;
+        double v = 0.0;
+        if(piece == TUNE_DARK){
+            for(int k = 0; k < TUNE_PIECE_NUM; ++k){
+                v += position.pool[side][k] * theta[k * SQUARE_NUM + sq];
+            }
+        }else{
+            v = theta[piece * SQUARE_NUM + sq];
+        }
+        e += side ? -v : v;
+    }
+    return e;
+}
+
+static inline double _loss(double e, double scale, double target){
+    const double p = 1.0 / (1.0 + exp(-scale * e));
+    const double eps = 1e-12;
+    return -(target * log(p + eps) + (1.0 - target) * log(1.0 - p + eps));
+}
+
+//返回平均loss, grad不为NULL时累加梯度(d loss / d theta)
+static double _epoch(const TuneData& data, const double* theta, double scale, int threads, double* grad){
+    const int n = TUNE_PIECE_NUM * SQUARE_NUM;
+    std::vector<std::vector<double>> grads(threads, std::vector<double>(grad ? n : 0, 0.0));
+    std::vector<double> losses(threads, 0.0);
+    std::vector<std::thread> workers;
+    const size_t total = data.positions.size();
+    for(int t = 0; t < threads; ++t){
+        workers.emplace_back([&, t](){
+            const size_t begin = total * t / threads, end = total * (t + 1) / threads;
+            double loss = 0.0;
+            double* g = grad ? grads[t].data() : NULL;
+            for(size_t i = begin; i < end; ++i){
+                const TunePosition& position = data.positions[i];
+                const TuneEntry* entries = data.entries.data() + position.first;
+                const double e = _evaluate(position, entries, theta);
+                loss += _loss(e, scale, position.target);
+                if(!g){
+                    continue;
+                }
+                //logistic loss对e的导数
+                const double d = scale * (1.0 / (1.0 + exp(-scale * e)) - position.target);
+                for(int j = 0; j < position.count; ++j){
+                    const int sq = entries[j] & 127, piece = (entries[j] >> 7) & 7, side = entries[j] >> 10;
+                    const double ds = side ? -d : d;
+                    if(piece == TUNE_DARK){
+                        for(int k = 0; k < TUNE_PIECE_NUM; ++k){
+                            g[k * SQUARE_NUM + sq] += ds * position.pool[side][k];
+                        }
+                    }else{
+                        g[piece * SQUARE_NUM + sq] += ds;
+                    }
+                }
+            }
+            losses[t] = loss;
+        });
+    }
+    for(std::thread& worker : workers){
+        worker.join();
+    }
+    double loss = 0.0;
+    for(int t = 0; t < threads; ++t){
+        loss += losses[t];
+        if(grad){
+            for(int i = 0; i < n; ++i){
+                grad[i] += grads[t][i];
+            }
+        }
+    }
+    if(grad){
+        for(int i = 0; i < n; ++i){
+            grad[i] /= total;
+        }
+    }
+    return loss / total;
+}
+
+//分数到胜率的缩放系数, 在对数尺度上三分
+static double _fit_scale(const TuneData& data, const double* theta, int threads){
+    double lo = log(1e-4), hi = log(1e-1);
+    for(int it = 0; it < 40; ++it){
+        const double m1 = lo + (hi - lo) / 3, m2 = hi - (hi - lo) / 3;
+        if(_epoch(data, theta, exp(m1), threads, NULL) < _epoch(data, theta, exp(m2), threads, NULL)){
+            hi = m2;
+        }else{
+            lo = m1;
+        }
+    }
+    return exp((lo + hi) / 2);
+}
+
+static bool _write_score_table(const char* score_file, const double* theta){
+    std::ofstream out(score_file, std::ios::trunc);
+    if(!out.is_open()){
+        printf("[FAILED 1]tune --> tune.cpp --> Open %s FAILED!\n", score_file);
+        return false;
+    }
+    //和原来的score.conf同样的顺序
+    for(const char c : std::string("CBANRPK")){
+        out << c << "\n\n";
+        for(int x = 0; x < 10; ++x){
+            for(int y = 0; y < 9; ++y){
+                const int sq = SQ(ENCODE(x, y));
+                const int k = _tune_piece(c);
+                const long v = k >= 0 ? lround(theta[k * SQUARE_NUM + sq]) : pstglobal[3][PID(c)][sq];
+                out << std::max(-32768L, std::min(32767L, v)) << (y < 8 ? ", " : "\n");
+            }
+        }
+        out << "\n";
+    }
+    return true;
+}
+
+static bool _parse(int argc, char* argv[], TuneOptions& opt){
+    for(int i = 1; i < argc; ++i){
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if(arg == "-t" && has_value){
+            opt.threads = std::max(1, atoi(argv[++i]));
+        }else if(arg == "-e" && has_value){
+            opt.epochs = atoi(argv[++i]);
+        }else if(arg == "-l" && has_value){
+            opt.lr = atof(argv[++i]);
+        }else if(arg == "-m" && has_value){
+            opt.margin = atoi(argv[++i]);
+        }else if(arg == "-q" && has_value){
+            opt.quiesc_depth = atoi(argv[++i]);
+        }else if(arg == "-i" && has_value){
+            opt.input = argv[++i];
+        }else if(arg == "-o" && has_value){
+            opt.output = argv[++i];
+        }else if(!arg.empty() && arg[0] == '-'){
+            return false;
+        }else{
+            opt.files.push_back(arg);
+        }
+    }
+    return !opt.files.empty();
+}
+
+int main(int argc, char* argv[]){
+    TuneOptions opt;
+    if(!_parse(argc, argv, opt)){
+        printf("usage: %s [-t threads] [-e epochs] [-l lr] [-m margin] [-q quiesc_depth] [-i score.conf] [-o out.conf] data.bin...\n", argv[0]);
+        return 1;
+    }
+    srand(time(NULL));
+    IntializeL1();
+    IntializeZobrist();
+    memset(pstglobal, 0, sizeof(pstglobal));
+    for(int i = 2; i <= 4; ++i){
+        if(!read_score_table(opt.input.c_str(), pstglobal[i])){
+            return 1;
+        }
+    }
+    TuneData data;
+    if(!_load(opt, data)){
+        return 1;
+    }
+    const int n = TUNE_PIECE_NUM * SQUARE_NUM;
+    std::vector<double> theta(n), grad(n), m(n, 0.0), v(n, 0.0);
+    for(int k = 0; k < TUNE_PIECE_NUM; ++k){
+        for(int s = 0; s < SQUARE_NUM; ++s){
+            theta[k * SQUARE_NUM + s] = pstglobal[3][PID(TUNE_PIECES[k])][s];
+        }
+    }
+    const double scale = _fit_scale(data, theta.data(), opt.threads);
+    printf("scale = %.6f, initial loss = %.6f, threads = %d\n", scale, _epoch(data, theta.data(), scale, opt.threads, NULL), opt.threads);
+    //Adam, 全量梯度
+    const double beta1 = 0.9, beta2 = 0.999, eps = 1e-8;
+    for(int epoch = 1; epoch <= opt.epochs; ++epoch){
+        auto start = std::chrono::high_resolution_clock::now();
+        std::fill(grad.begin(), grad.end(), 0.0);
+        const double loss = _epoch(data, theta.data(), scale, opt.threads, grad.data());
+        for(int i = 0; i < n; ++i){
+            m[i] = beta1 * m[i] + (1 - beta1) * grad[i];
+            v[i] = beta2 * v[i] + (1 - beta2) * grad[i] * grad[i];
+            const double mhat = m[i] / (1 - pow(beta1, epoch)), vhat = v[i] / (1 - pow(beta2, epoch));
+            theta[i] -= opt.lr * mhat / (sqrt(vhat) + eps);
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        printf("epoch %d: loss = %.6f, %.1f ms, %.0f positions/s, threads = %d\n", epoch, loss, ms, data.positions.size() / (ms / 1000.0), opt.threads);
+    }
+    printf("final loss = %.6f\n", _epoch(data, theta.data(), scale, opt.threads, NULL));
+    if(!_write_score_table(opt.output.c_str(), theta.data())){
+        return 1;
+    }
+    printf("written to %s\n", opt.output.c_str());
+    return 0;
+}
@@ -12,7 +12,17 @@
 #include <limits>
 #include "MCTSBoard.h"
 #include "MCTSGameSimulator.h"
+#include "MCTSEval.h"
 #include <malloc.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define DUCT_SSE 1
+#include <emmintrin.h>
+#else
+#define DUCT_SSE 0
+#endif
+#include <thread>
+#include <atomic>
+#include <memory>
 
 namespace board{
     namespace _DUCT{
@@ -31,68 +41,221 @@ namespace board{
                 return *this;
             }
         };
+        // DUCT的节点: 放在DUCT::nodes里, 子节点在nodes里连续放, 用下标连; 统计量不在节点里, 放在DUCT的SoA数组里, 下标和nodes一样
+        // first_child为0是还没展开(0是根, 不会是谁的子节点), 展开了但无子可走时nchildren为0
         struct Node{
             uint64_t zobrist = 0ull;
-            stats eval;
-            Move move;
-            Node *child = nullptr, *sibling = nullptr;
-            Node* select_child(){
-                static constexpr double c = 1.1; // an empirically decided value
-                if(!eval.count) return child;
-                double rln = c * sqrt(log(eval.count));
-                double polMax = -numeric_limits<double>::infinity();
-                Node *sel = nullptr, *ptr = child;
-                while(ptr){
-                    if(!ptr->eval.count) return ptr;
-                    double u = ptr->eval.avg_eval + rln / sqrt(eval.count);
-                    if(u>polMax){
-                        polMax = u;
-                        sel = ptr;
-                    }
-                    ptr = ptr->sibling;
+            uint32_t first_child = 0;
+            uint16_t nchildren = 0;
+            Move move{0, 0};
+        };
+        static_assert(sizeof(Node) <= 32, "DUCT::Node should stay small");
+
+        // UCB = 平均分 + c * sqrt(log(父节点访问次数)) / sqrt(子节点访问次数), 两个因子查表, 表外才现算
+        struct UCBTable{
+            static constexpr double c = 1.1; // an empirically decided value
+            static constexpr int SIZE = 1 << 14;
+            float rln[SIZE], inv_sqrt[SIZE];
+            UCBTable(){
+                rln[0] = inv_sqrt[0] = 0;
+                for(int n = 1; n < SIZE; ++n){
+                    rln[n] = c * sqrt(log(n));
+                    inv_sqrt[n] = 1 / sqrt(n);
                 }
-                return sel;
+            }
+            float parent(int n) const{ return n < SIZE ? rln[n] : c * sqrt(log(n)); }
+            float child(int n) const{ return n < SIZE ? inv_sqrt[n] : 1 / sqrt(n); }
+            static const UCBTable& get(){
+                static const UCBTable table;
+                return table;
             }
         };
 
+        // 没访问过的子节点平均分记成这个, explore记0, UCB算出来比谁都大, 就先走它
+        static constexpr float UNVISITED = 1e30f;
+
+        // 返回mean[i] + rln * explore[i]最大的下标, 一样大取最前面的(和原来一个个比、严格大于才换一样)
+        inline int ucb_argmax(const float* mean, const float* explore, int n, float rln){
+            float u[MCTSSim::MAX_MOVES];
+            float best = -numeric_limits<float>::infinity();
+            int i = 0;
+#if DUCT_SSE
+            const __m128 vrln = _mm_set1_ps(rln);
+            __m128 vbest = _mm_set1_ps(best);
+            for(; i + 4 <= n; i += 4){
+                const __m128 v = _mm_add_ps(_mm_loadu_ps(mean + i), _mm_mul_ps(vrln, _mm_loadu_ps(explore + i)));
+                _mm_storeu_ps(u + i, v);
+                vbest = _mm_max_ps(vbest, v);
+            }
+            vbest = _mm_max_ps(vbest, _mm_shuffle_ps(vbest, vbest, 0x4E));
+            vbest = _mm_max_ps(vbest, _mm_shuffle_ps(vbest, vbest, 0xB1));
+            best = _mm_cvtss_f32(vbest);
+#endif
+            for(; i < n; ++i){
+                u[i] = mean[i] + rln * explore[i];
+                best = max(best, u[i]);
+            }
+            i = 0;
+#if DUCT_SSE
+            vbest = _mm_set1_ps(best);
+            for(; i + 4 <= n; i += 4){
+                const int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(u + i), vbest));
+                if(mask) return i + __builtin_ctz(mask);
+            }
+#endif
+            for(; i < n; ++i)
+                if(u[i] == best) return i;
+            return 0;
+        }
+
+        // rollout的走子策略. heavy为false时均匀随机; 为true时按分数做softmax, 概率正比于exp(分数/temperature):
+        // 分数 = 吃到的子的价值(MVV, 兵算1) + 走完以后能吃将(mate_level为2)时加check_bonus
+        // 能吃将时generate_moves只给吃将这一步, 所以吃将总是必走的
+        // leaf不是PLAYOUT时rollout截断: 走truncate步(0是展开时直接打分)以后用AIBoard4的子力位置分打分(MCTSEval),
+        // STATIC直接用静态分, QUIESCENCE先做qdepth层只吃子的搜索; 分数除以eval_scale取tanh映射到[-1, 1]
+        struct PlayoutPolicy{
+            enum Leaf{ PLAYOUT, STATIC, QUIESCENCE };
+            bool heavy = false;
+            double temperature = 1.0;
+            double check_bonus = 2.0; // 为0时不试走, 省掉每个着法一次move/mate_level/undo_move
+            Leaf leaf = PLAYOUT;
+            int truncate = 0;
+            int qdepth = 4;
+            double eval_scale = 400; // 差不多一个车的分数映射到0.75
+        };
+
+        // 截断时给行棋方打分, [-1, 1]
+        inline double leaf_value(MCTSSim::DeterminizedSimulator* sim, const PlayoutPolicy& policy){
+            if(policy.leaf == PlayoutPolicy::QUIESCENCE)
+                return MCTSEval::quiescence(sim, -1, 1, policy.qdepth, policy.eval_scale);
+            return MCTSEval::squash(MCTSEval::static_score(*sim), policy.eval_scale);
+        }
+
+        // 被吃掉的子值多少个兵, 暗子按它可能是的子的平均算
+        inline double playout_piece_value(unsigned char piece){
+            switch(_MCTS::to_self(piece)){
+                case 'R': return 9;
+                case 'C': return 4.5;
+                case 'N': return 4;
+                case 'B': case 'A': return 2;
+                case 'P': return 1;
+                case 'D': case 'E': case 'F': case 'G': case 'H': case 'I': return 3.5;
+                default: return 0;
+            }
+        }
+
+        // 按policy从moves里挑一个着法, 返回下标
+        inline int pick_playout_move(MCTSSim::DeterminizedSimulator* sim, MCTSSim::MoveSpan moves, const PlayoutPolicy& policy){
+            if(!policy.heavy) return sim->rng->sample(moves.size());
+            if(moves.size() == 1) return 0;
+            // moves是ply1(红方)的坐标, 黑方走时在ply2上旋转过来算
+            MCTSBoard& b = sim->turn ? sim->ply1 : sim->ply2;
+            double weight[MCTSSim::MAX_MOVES], best = -numeric_limits<double>::infinity();
+            for(int i = 0; i < moves.n; ++i){
+                const int from = sim->turn ? moves[i].from : 254 - moves[i].from;
+                const int to = sim->turn ? moves[i].to : 254 - moves[i].to;
+                double score = playout_piece_value(b.board[to]);
+                if(policy.check_bonus != 0){
+                    // 暗子不翻开, 按它所在位置的走法算
+                    const MCTSBoard::Move_Result mr = b.move(from, to);
+                    if(b.mate_level(to) == 2) score += policy.check_bonus;
+                    b.undo_move(to, from, mr);
+                }
+                weight[i] = score;
+                best = max(best, score);
+            }
+            double sum = 0;
+            for(int i = 0; i < moves.n; ++i){
+                weight[i] = exp((weight[i] - best) / policy.temperature);
+                sum += weight[i];
+            }
+            double r = sim->rng->uniform() * sum;
+            for(int i = 0; i + 1 < moves.n; ++i){
+                r -= weight[i];
+                if(r < 0) return i;
+            }
+            return moves.n - 1;
+        }
+
+        // 从当前局面按policy走到底(最多dep_lim步)再退回来, 返回对行棋方的分数; DUCT和TreeParallelDUCT共用
+        // 不递归: 记下分出胜负的是第几层, 每往上一层换一次方
+        inline double playout(MCTSSim::DeterminizedSimulator* sim, const PlayoutPolicy& policy = PlayoutPolicy(), int dep_lim = 200){
+            using game = MCTSSim::DeterminizedSimulator;
+            double val = 0; // didn't terminate
+            int ply = 0, made = 0;
+            for(; ply < dep_lim; ++ply){
+                if(policy.leaf != PlayoutPolicy::PLAYOUT && ply == policy.truncate){
+                    val = leaf_value(sim, policy);
+                    break;
+                }
+                const MCTSSim::MoveSpan moves = sim->generate_moves();
+                if(moves.empty()){ // 无子可走, 行棋方输
+                    val = -1;
+                    break;
+                }
+                const int sel = pick_playout_move(sim, moves, policy);
+                const int vali = sim->move(moves[sel].from, moves[sel].to);
+                ++made;
+                if(vali != game::unterminated){
+                    val = sim->turn ? -vali : vali; // if this node is on the opponent side, then revert the value
+                    break;
+                }
+            }
+            if(ply & 1) val = -val;
+            while(made--) sim->undo_move();
+            return val;
+        }
+
+        // 节点和统计量都用下标访问, 递归里nodes会变长, 不拿引用
+        // 子节点的mean/explore/visits连续放, select_child一次读完一个节点所有子节点的统计, 用ucb_argmax挑
         struct DUCT{
             using game = MCTSSim::DeterminizedSimulator;
-            vector<Node*> mem;
-            int nallocCount = 0;
-            Node* alloc(){
-                Node* result = nullptr;
-                if(nallocCount < mem.size() * 2048){
-                    result = mem[nallocCount >> 11]+(nallocCount & 2047);
-                }else{
-                    mem.push_back((Node*)calloc(2048, sizeof(Node)));
-                    result = mem[nallocCount >> 11];
-                }
-                ++nallocCount;
-                return result;
-            }
-            ~DUCT(){
-                for(auto t: mem) free(t);
-            }
-            void clearAlloc(){ nallocCount = 0; }
+            vector<Node> nodes;
+            vector<float> mean, explore; // 平均分(没访问过是UNVISITED)和1 / sqrt(访问次数)
+            vector<int> visits;
+            uint32_t new_node(Move move){
+                Node node;
+                node.move = move;
+                nodes.push_back(node);
+                mean.push_back(UNVISITED);
+                explore.push_back(0);
+                visits.push_back(0);
+                return nodes.size() - 1;
+            }
+            // 清空时不释放内存, 下一个确定化接着用
+            void clearAlloc(){
+                nodes.clear();
+                mean.clear();
+                explore.clear();
+                visits.clear();
+            }
+            int nallocCount() const{ return nodes.size(); }
+            void update(uint32_t n, double val){
+                const int k = ++visits[n];
+                mean[n] = k == 1 ? val : mean[n] + (val - mean[n]) / k;
+                explore[n] = UCBTable::get().child(k);
+            }
+            uint32_t select_child(uint32_t n){
+                const uint32_t first = nodes[n].first_child;
+                return first + ucb_argmax(&mean[first], &explore[first], nodes[n].nchildren, UCBTable::get().parent(visits[n]));
+            }
             vector<std::pair<Move, stats> > root_moves;
             vector<Move> moves;
             game* sim;
             uint64_t zobrist;
+            PlayoutPolicy policy;
             DUCT(game* sim):sim(sim){
-                moves = sim->generate_moves();
+                auto _moves = sim->generate_moves();
+                moves.assign(_moves.begin(), _moves.end());
                 for(auto move: moves)
                     root_moves.emplace_back(move, stats());
                 zobrist = sim->ply1.board_zobrist;
             }
-            Node* generate_move_nodes(Node* parent, const vector<Move>& _moves){
-                Node* last = nullptr;
-                for(auto t = _moves.rbegin(); t!=moves.rend(); ++t){
-                    Node* newnode = new(alloc()) Node();
-                    newnode->move = *t;
-                    newnode->sibling = last;
-                    last = newnode;
-                }
-                return parent->child = last;
+            void generate_move_nodes(uint32_t parent, MCTSSim::MoveSpan _moves){
+                const uint32_t first = nodes.size();
+                for(const Move& move: _moves) new_node(move);
+                nodes[parent].first_child = first;
+                nodes[parent].nchildren = _moves.n;
             }
             std::string ptos_(int pos){
                 int x = 12 - (pos >> 4);
@@ -101,6 +264,7 @@ namespace board{
                 return string(str);
             }
             double rollout(int dep_lim = 200, bool verbose = false){
+                if(!verbose) return playout(sim, policy, dep_lim);
                 if(verbose) {
                     std::cout << "移动: " << ptos_(sim->mvstack.top().from) << ptos_(sim->mvstack.top().to)
                               << std::endl;
@@ -109,7 +273,8 @@ namespace board{
                 }
                 if(dep_lim <= 0) return 0; // didn't terminate
                 auto moves = sim->generate_moves();
-                int sel = _MCTS::RNG::get()->sample(moves.size());
+                if(moves.empty()) return -1; // 无子可走, 行棋方输
+                int sel = sim->rng->sample(moves.size());
                 int vali = (double)sim->move(moves[sel].from, moves[sel].to);
                 double val = vali;
                 if(vali == game::unterminated)
@@ -130,46 +295,47 @@ namespace board{
                 }
                 return val;
             }
-            double expand(Node* node, bool verbose = false){
-                if(!sim->state_value.empty() && sim->state_value.top() != game::unterminated) // game is terminated
-                    return sim->state_value.top();
-                if(!node->child){
-                    node->zobrist = sim->ply1.board_zobrist;
-                    auto _moves = sim->generate_moves();
-                    generate_move_nodes(node, _moves);
-                }
-                if(node->zobrist != sim->ply1.board_zobrist){
-                    std::cout << node->zobrist << " : " << sim->ply1.compute_board_zobrist_const() << " : " << sim->ply1.board_zobrist << endl;
-                    assert(node->zobrist == sim->ply1.board_zobrist);
-                }
-                Node* sel = node->select_child();
-                sim->move(sel->move.from, sel->move.to);
-                double val = 0.;
-                if(!sel->eval.count) {
-                    val = rollout(200, verbose);
-                    sel->eval += val;
-                    val = -val;
-                }
-                else val = -expand(sel, verbose);
-                node->eval += val;
+            // 返回对node行棋方的分数. 子节点的eval存的是走到它的那一方(也就是node的行棋方)的分数, select_child挑对自己最好的
+            double expand(uint32_t node, bool verbose = false){
+                if(!sim->state_value.empty() && sim->state_value.top() != game::unterminated){ // game is terminated
+                    const int v = sim->state_value.top(); // 红方(ply1)视角, 换成行棋方的
+                    return sim->turn ? v : -v;
+                }
+                if(!nodes[node].first_child){
+                    nodes[node].zobrist = sim->ply1.board_zobrist;
+                    generate_move_nodes(node, sim->generate_moves());
+                }
+                if(!nodes[node].nchildren) return -1; // 无子可走, 行棋方输
+                if(nodes[node].zobrist != sim->ply1.board_zobrist){
+                    std::cout << nodes[node].zobrist << " : " << sim->ply1.compute_board_zobrist_const() << " : " << sim->ply1.board_zobrist << endl;
+                    assert(nodes[node].zobrist == sim->ply1.board_zobrist);
+                }
+                const uint32_t sel = select_child(node);
+                const int vali = sim->move(nodes[sel].move.from, nodes[sel].move.to);
+                double val = 0.; // 对sel行棋方的分数
+                if(vali != game::unterminated) val = sim->turn ? vali : -vali; // 这一步就分出了胜负, 不用rollout
+                else if(!visits[sel]) val = rollout(200, verbose);
+                else val = expand(sel, verbose);
+                update(sel, -val);
                 sim->undo_move();
-                return val;
+                return -val;
             }
-            Node* root;
+            static constexpr uint32_t root = 0;
             void determinize(int rollouts){
                 sim->determinize();
                 // initialize root node
                 clearAlloc();
-                root = new(alloc()) Node();
-                root->zobrist = sim->ply1.board_zobrist;
+                new_node({0, 0});
+                nodes[root].zobrist = sim->ply1.board_zobrist;
                 // expand root node
-                generate_move_nodes(root, moves);
+                generate_move_nodes(root, {moves.data(), (int)moves.size()});
                 for(int i=0;i<rollouts;++i){
                     /*
                     sim->print();
                     std::cout << "zobrist: " << sim->ply1.board_zobrist << std::endl;
                      */
                     double val = expand(root, (i & 10) == 9);
+                    update(root, val); // 根的访问次数给select_child用
                     /*
                     sim->print();
                     std::cout << "zobrist: " << sim->ply1.board_zobrist << std::endl;
@@ -177,12 +343,252 @@ namespace board{
                     // std::cout << "于 MCTS 的根处: " << val << '\n';
                     // std::cout << root -> zobrist << " : " << reinterpret_cast<uint64_t>(root) << " : " << reinterpret_cast<uint64_t>(root->child) << endl;
                 }
-                Node* ch = root -> child;
+                uint32_t ch = nodes[root].first_child;
                 for(auto& stat: root_moves){
-                    stat.second += ch->eval;
-                    ch = ch->sibling;
+                    stats s;
+                    s.count = visits[ch];
+                    s.avg_eval = s.count ? mean[ch] : 0;
+                    s.total_eval = s.avg_eval * s.count;
+                    stat.second += s;
+                    ++ch;
+                }
+            }
+        };
+
+        // 根统计里访问次数最多的着法, 一样多时取平均分高的; 没有访问过的着法时返回{0, 0}
+        // 不按平均分挑: 只访问过几次的着法平均分很容易偏高
+        inline Move best_root_move(const vector<pair<Move, stats> >& root_moves){
+            Move result = {0, 0};
+            int best_count = 0;
+            double best_eval = -numeric_limits<double>::infinity();
+            for(const auto& stat: root_moves){
+                const int count = stat.second.count;
+                if(count > best_count || (count && count == best_count && stat.second.avg_eval > best_eval)){
+                    best_count = count;
+                    best_eval = stat.second.avg_eval;
+                    result = stat.first;
+                }
+            }
+            return result;
+        }
+
+        // 根并行: 每个线程从sim拷一份模拟器, 配自己的Randomizer和DUCT树(节点内存也是自己的), 从共享的计数器领确定化的编号
+        // 第d个确定化的随机数只由seed和d决定, 结果和线程数、哪个线程领到无关; 最后按着法把各个线程的根统计加起来
+        struct RootParallelDUCT{
+            vector<pair<Move, stats> > root_moves;
+            size_t nodes = 0; // 各个确定化分配过的节点数之和
+            PlayoutPolicy policy;
+            void run(const DUCT::game& sim, int determinizations, int rollouts, int threads, uint32_t seed){
+                threads = max(1, min(threads, determinizations));
+                vector<_MCTS::Randomizer> rngs(threads);
+                vector<DUCT::game> sims(threads, sim);
+                vector<unique_ptr<DUCT> > trees;
+                for(int t = 0; t < threads; ++t){
+                    sims[t].rng = &rngs[t];
+                    trees.emplace_back(new DUCT(&sims[t]));
+                    trees.back()->policy = policy;
+                }
+                atomic<int> next(0);
+                vector<size_t> worker_nodes(threads, 0);
+                vector<thread> workers;
+                for(int t = 0; t < threads; ++t){
+                    workers.emplace_back([&, t](){
+                        for(int d = next.fetch_add(1); d < determinizations; d = next.fetch_add(1)){
+                            const uint32_t key[2] = {seed, (uint32_t)d};
+                            rngs[t] = _MCTS::Randomizer((const char*)key, (const char*)(key + 2));
+                            // determinize是在原来的顺序上洗牌, 先恢复成根的顺序, 不然会受这个线程前面几个确定化的影响
+                            sims[t].ply1_piece = sim.ply1_piece;
+                            sims[t].ply2_piece = sim.ply2_piece;
+                            trees[t]->determinize(rollouts);
+                            worker_nodes[t] += trees[t]->nallocCount();
+                        }
+                    });
+                }
+                for(auto& worker: workers) worker.join();
+                // 各个树的根着法顺序一样, 还是按着法合并, 不依赖这一点
+                unordered_map<int, size_t> index;
+                root_moves.clear();
+                nodes = 0;
+                for(int t = 0; t < threads; ++t){
+                    nodes += worker_nodes[t];
+                    for(const auto& stat: trees[t]->root_moves){
+                        const int key = stat.first.from << 8 | stat.first.to;
+                        if(!index.count(key)){
+                            index[key] = root_moves.size();
+                            root_moves.emplace_back(stat.first, stats());
+                        }
+                        root_moves[index[key]].second += stat.second;
+                    }
+                }
+            }
+            Move best() const{ return best_root_move(root_moves); }
+        };
+
+        // 树并行用的节点: 统计量是原子的, 几个线程同时在一棵树上走
+        // count是真正回传过的次数, vloss是正在经过这个节点、还没回传的线程数(虚拟损失)
+        // state: 0没展开, 1某个线程正在生成子节点, 2展开好了(child可以读)
+        struct SharedNode{
+            static constexpr double virtual_loss = 1.0; // 每个在路上的线程按输一盘算
+            atomic<double> total_eval{0.0};
+            atomic<int> count{0}, vloss{0};
+            atomic<int> state{0};
+            atomic<SharedNode*> child{nullptr};
+            SharedNode* sibling = nullptr;
+            Move move{0, 0};
+            void add(double val){
+                double old = total_eval.load(memory_order_relaxed);
+                while(!total_eval.compare_exchange_weak(old, old + val, memory_order_relaxed));
+                count.fetch_add(1, memory_order_relaxed);
+            }
+            // 和DUCT::select_child一样的公式, 只是算上虚拟损失: 别的线程正在走的子节点看起来更差, 就会分开走
+            // first是调用方已经读到、检查过非空的child, 不再读一次
+            SharedNode* select_child(SharedNode* first){
+                static constexpr double c = 1.1;
+                const int n = count.load(memory_order_relaxed) + vloss.load(memory_order_relaxed);
+                if(!n) return first;
+                double rln = c * sqrt(log(n));
+                double polMax = -numeric_limits<double>::infinity();
+                SharedNode *sel = first, *ptr = first;
+                while(ptr){
+                    const int v = ptr->vloss.load(memory_order_relaxed);
+                    const int cn = ptr->count.load(memory_order_relaxed) + v;
+                    if(!cn) return ptr;
+                    double u = (ptr->total_eval.load(memory_order_relaxed) - virtual_loss * v) / cn + rln / sqrt(cn);
+                    if(u>polMax){
+                        polMax = u;
+                        sel = ptr;
+                    }
+                    ptr = ptr->sibling;
+                }
+                return sel;
+            }
+        };
+
+        // 树并行: 每个确定化只建一棵树, threads个线程一起往下走, 一共做rollouts次rollout
+        // 每个线程有自己的模拟器(确定化以后拷过去的)、随机数和节点内存; 节点由抢到state 0->1的线程生成, 别的线程在这里直接rollout
+        // 根统计按确定化累加, 和DUCT::root_moves的含义一样
+        struct TreeParallelDUCT{
+            using game = MCTSSim::DeterminizedSimulator;
+            struct Worker{
+                game sim;
+                _MCTS::Randomizer rng;
+                PlayoutPolicy policy;
+                vector<SharedNode*> mem;
+                int nallocCount = 0;
+                explicit Worker(const game& sim): sim(sim){
+                    this->sim.rng = &rng;
+                }
+                Worker(const Worker&) = delete;
+                ~Worker(){
+                    for(auto t: mem) free(t);
+                }
+                SharedNode* alloc(){
+                    if(nallocCount >= (int)mem.size() * 2048)
+                        mem.push_back((SharedNode*)malloc(2048 * sizeof(SharedNode)));
+                    SharedNode* result = new(mem[nallocCount >> 11] + (nallocCount & 2047)) SharedNode();
+                    ++nallocCount;
+                    return result;
+                }
+                void generate_move_nodes(SharedNode* parent, MCTSSim::MoveSpan _moves){
+                    SharedNode* last = nullptr;
+                    for(int t = _moves.n - 1; t >= 0; --t){
+                        SharedNode* newnode = alloc();
+                        newnode->move = _moves[t];
+                        newnode->sibling = last;
+                        last = newnode;
+                    }
+                    parent->child.store(last, memory_order_release);
+                }
+                // 返回对node行棋方的分数, 和DUCT::expand一样
+                double expand(SharedNode* node){
+                    if(!sim.state_value.empty() && sim.state_value.top() != game::unterminated){ // game is terminated
+                        const int v = sim.state_value.top(); // 红方(ply1)视角, 换成行棋方的
+                        return sim.turn ? v : -v;
+                    }
+                    if(node->state.load(memory_order_acquire) != 2){
+                        int expected = 0;
+                        if(node->state.compare_exchange_strong(expected, 1, memory_order_acq_rel)){
+                            generate_move_nodes(node, sim.generate_moves());
+                            node->state.store(2, memory_order_release);
+                        }else if(expected != 2){
+                            // 别的线程正在展开, 不等它, 从这里rollout
+                            return playout(&sim, policy);
+                        }
+                        // expected为2: 刚被别的线程展开好, 接着往下选
+                    }
+                    SharedNode* const first = node->child.load(memory_order_acquire);
+                    if(!first) return -1; // 无子可走, 行棋方输
+                    SharedNode* sel = node->select_child(first);
+                    sel->vloss.fetch_add(1, memory_order_relaxed);
+                    const int vali = sim.move(sel->move.from, sel->move.to);
+                    double val = 0.; // 对sel行棋方的分数
+                    if(vali != game::unterminated) val = sim.turn ? vali : -vali;
+                    else if(!sel->count.load(memory_order_relaxed) && !sel->state.load(memory_order_relaxed)) val = playout(&sim, policy);
+                    else val = expand(sel);
+                    sel->add(-val); // 和Node一样, 存走到sel的那一方的分数
+                    sel->vloss.fetch_sub(1, memory_order_relaxed);
+                    sim.undo_move();
+                    return -val;
+                }
+            };
+            vector<pair<Move, stats> > root_moves;
+            size_t nodes = 0; // 各个确定化分配过的节点数之和
+            PlayoutPolicy policy;
+            void run(const game& sim, int determinizations, int rollouts, int threads, uint32_t seed){
+                threads = max(1, threads);
+                game root_sim(sim);
+                _MCTS::Randomizer root_rng;
+                root_sim.rng = &root_rng;
+                const MCTSSim::MoveSpan root_span = root_sim.generate_moves();
+                const vector<Move> moves(root_span.begin(), root_span.end());
+                root_moves.clear();
+                for(auto move: moves)
+                    root_moves.emplace_back(move, stats());
+                nodes = 0;
+                vector<unique_ptr<Worker> > workers;
+                for(int t = 0; t < threads; ++t){
+                    workers.emplace_back(new Worker(sim));
+                    workers.back()->policy = policy;
+                }
+                for(int d = 0; d < determinizations; ++d){
+                    const uint32_t key[2] = {seed, (uint32_t)d}; // 和RootParallelDUCT的第d个确定化一样
+                    root_rng = _MCTS::Randomizer((const char*)key, (const char*)(key + 2));
+                    root_sim.ply1_piece = sim.ply1_piece;
+                    root_sim.ply2_piece = sim.ply2_piece;
+                    root_sim.determinize();
+                    for(int t = 0; t < threads; ++t){
+                        const uint32_t worker_key[3] = {seed, (uint32_t)d, (uint32_t)t + 1};
+                        workers[t]->sim = root_sim;
+                        workers[t]->sim.rng = &workers[t]->rng;
+                        workers[t]->rng = _MCTS::Randomizer((const char*)worker_key, (const char*)(worker_key + 3));
+                        workers[t]->nallocCount = 0;
+                    }
+                    SharedNode* root = workers[0]->alloc();
+                    workers[0]->generate_move_nodes(root, {moves.data(), (int)moves.size()});
+                    root->state.store(2, memory_order_release);
+                    atomic<int> started(0);
+                    vector<thread> pool;
+                    for(int t = 0; t < threads; ++t){
+                        pool.emplace_back([&, t](){
+                            while(started.fetch_add(1, memory_order_relaxed) < rollouts)
+                                root->add(workers[t]->expand(root)); // 根的访问次数给select_child用
+                        });
+                    }
+                    for(auto& worker: pool) worker.join();
+                    SharedNode* ch = root->child.load(memory_order_acquire);
+                    for(auto& stat: root_moves){
+                        stats s;
+                        s.total_eval = ch->total_eval.load();
+                        s.count = ch->count.load();
+                        s.avg_eval = s.count ? s.total_eval / s.count : 0;
+                        stat.second += s;
+                        ch = ch->sibling;
+                    }
+                    for(int t = 0; t < threads; ++t)
+                        nodes += workers[t]->nallocCount;
                 }
             }
+            Move best() const{ return best_root_move(root_moves); }
         };
     }
 }
@@ -0,0 +1,181 @@
+#ifndef CPPJIEQI_ISMCTS_H
+#define CPPJIEQI_ISMCTS_H
+
+#include "DUCT.h"
+
+namespace board{
+    namespace _DUCT{
+        // 信息集MCTS(SO-ISMCTS): 只建一棵树, 每次迭代重新确定化一次, 统计量在所有确定化之间共享
+        // 节点是信息集, 用双方都看得见的棋盘(ply1.board_zobrist, 暗子只看得见是暗子)区分; 走暗子翻出不同的子是不同的信息集,
+        // 挂在同一条边下面, 用sibling串起来, 走完以后按当前确定化翻出来的棋盘找
+        // 边的eval存的是这个信息集行棋方的分数, 和修过的DUCT::Node一样; 节点和边放在vector里用下标连, 清空时不释放内存
+        // 真正走了一步以后用advance把这步(和看到的翻子结果)对应的子树提成根, 下一次search接着这棵子树搜
+        struct ISMCTS{
+            using game = MCTSSim::DeterminizedSimulator;
+            static constexpr uint32_t NONE = ~0u;
+            struct Edge{
+                Move move;
+                stats eval;
+                int avail = 0; // 经过这个信息集时这个着法能走的次数, UCB用它代替父节点的访问次数
+                uint32_t child = NONE; // 走完以后的第一个信息集
+            };
+            struct Node{
+                uint64_t zobrist = 0ull;
+                uint32_t first_edge = 0, nedges = 0;
+                uint32_t sibling = NONE; // 同一条边下面的下一个信息集
+                bool expanded = false;
+            };
+            vector<Node> nodes;
+            vector<Edge> edges;
+            game* sim;
+            PlayoutPolicy policy;
+            uint32_t root = NONE;
+            vector<pair<Move, stats> > root_moves;
+            vector<Node> spare_nodes; // compact搬子树用, 和nodes/edges来回交换, 内存一直留着
+            vector<Edge> spare_edges;
+            explicit ISMCTS(game* sim): sim(sim){}
+
+            void clear(){
+                nodes.clear();
+                edges.clear();
+                root = NONE;
+            }
+            uint32_t new_node(uint64_t zobrist){
+                Node node;
+                node.zobrist = zobrist;
+                nodes.push_back(node);
+                return nodes.size() - 1;
+            }
+            // 着法只由看得见的棋盘决定, 所以同一个信息集上每次的着法都一样, 第一次经过时生成
+            void expand_node(uint32_t n){
+                const MCTSSim::MoveSpan moves = sim->generate_moves();
+                nodes[n].first_edge = edges.size();
+                nodes[n].nedges = moves.n;
+                nodes[n].expanded = true;
+                for(const Move& move: moves){
+                    Edge edge;
+                    edge.move = move;
+                    edges.push_back(edge);
+                }
+            }
+            // 根上所有边的访问次数之和, 也就是这棵树在根上已经有的迭代数
+            int root_visits() const{
+                if(root == NONE) return 0;
+                int visits = 0;
+                for(uint32_t i = nodes[root].first_edge; i < nodes[root].first_edge + nodes[root].nedges; ++i)
+                    visits += edges[i].eval.count;
+                return visits;
+            }
+            // 只留下以n为根的子树: 按层把节点搬到spare_nodes, 每个节点的边连续搬到spare_edges, 下标重新编, 再交换回来
+            // 新节点的first_edge在轮到它之前还是旧下标, 轮到它时才搬它的边
+            void compact(uint32_t n){
+                spare_nodes.clear();
+                spare_edges.clear();
+                spare_nodes.push_back(nodes[n]);
+                spare_nodes[0].sibling = NONE;
+                for(uint32_t k = 0; k < spare_nodes.size(); ++k){
+                    if(!spare_nodes[k].expanded) continue;
+                    const uint32_t first = spare_nodes[k].first_edge, count = spare_nodes[k].nedges;
+                    spare_nodes[k].first_edge = spare_edges.size();
+                    for(uint32_t i = first; i < first + count; ++i){
+                        Edge edge = edges[i];
+                        uint32_t head = NONE, tail = NONE;
+                        for(uint32_t child = edge.child; child != NONE; child = nodes[child].sibling){
+                            const uint32_t moved = spare_nodes.size();
+                            spare_nodes.push_back(nodes[child]);
+                            spare_nodes[moved].sibling = NONE;
+                            if(tail == NONE) head = moved;
+                            else spare_nodes[tail].sibling = moved;
+                            tail = moved;
+                        }
+                        edge.child = head;
+                        spare_edges.push_back(edge);
+                    }
+                }
+                nodes.swap(spare_nodes);
+                edges.swap(spare_edges);
+                root = 0;
+            }
+            // 棋盘上真正走了move(ply1坐标), 走完看得见的棋盘是zobrist(翻出来的子就是看到的那个): 找到对应的信息集提成根
+            // 自己走一步、对方走一步各调一次. 找不到(这步没搜过, 或者翻出来的子没碰到过)就清空, 下一次search从头开始
+            bool advance(Move move, uint64_t zobrist){
+                if(root == NONE || !nodes[root].expanded){
+                    clear();
+                    return false;
+                }
+                for(uint32_t i = nodes[root].first_edge; i < nodes[root].first_edge + nodes[root].nedges; ++i){
+                    if(edges[i].move.from != move.from || edges[i].move.to != move.to) continue;
+                    for(uint32_t child = edges[i].child; child != NONE; child = nodes[child].sibling)
+                        if(nodes[child].zobrist == zobrist){
+                            compact(child);
+                            return true;
+                        }
+                    break;
+                }
+                clear();
+                return false;
+            }
+            uint32_t select_edge(uint32_t first, uint32_t count){
+                static constexpr double c = 1.1; // 和DUCT一样
+                double polMax = -numeric_limits<double>::infinity();
+                uint32_t sel = first;
+                for(uint32_t i = first; i < first + count; ++i){
+                    const Edge& edge = edges[i];
+                    if(!edge.eval.count) return i;
+                    const double u = edge.eval.avg_eval + c * sqrt(log(edge.avail) / edge.eval.count);
+                    if(u > polMax){
+                        polMax = u;
+                        sel = i;
+                    }
+                }
+                return sel;
+            }
+            // 返回对信息集n行棋方的分数. nodes/edges在递归里会变长, 不拿引用
+            double iterate(uint32_t n){
+                if(!nodes[n].expanded) expand_node(n);
+                const uint32_t first = nodes[n].first_edge, count = nodes[n].nedges;
+                if(!count) return -1; // 无子可走, 行棋方输
+                for(uint32_t i = first; i < first + count; ++i) ++edges[i].avail;
+                const uint32_t sel = select_edge(first, count);
+                const int vali = sim->move(edges[sel].move.from, edges[sel].move.to);
+                double val = 0.; // 对走完以后行棋方的分数
+                if(vali != game::unterminated) val = sim->turn ? vali : -vali;
+                else{
+                    const uint64_t zobrist = sim->ply1.board_zobrist;
+                    uint32_t child = edges[sel].child;
+                    while(child != NONE && nodes[child].zobrist != zobrist) child = nodes[child].sibling;
+                    if(child == NONE){
+                        // 新的信息集: 挂上去, 从这里rollout
+                        child = new_node(zobrist);
+                        nodes[child].sibling = edges[sel].child;
+                        edges[sel].child = child;
+                        val = playout(sim, policy);
+                    }
+                    else val = iterate(child);
+                }
+                edges[sel].eval += -val;
+                sim->undo_move();
+                return -val;
+            }
+            // 从sim当前的局面再做iterations次迭代, 每次先重新确定化; 根统计写进root_moves
+            // advance留下的根就是当前局面时接着它搜, 否则清空重建
+            void search(int iterations){
+                if(root == NONE || nodes[root].zobrist != sim->ply1.board_zobrist){
+                    clear();
+                    root = new_node(sim->ply1.board_zobrist);
+                }
+                nodes.reserve(nodes.size() + iterations);
+                for(int i = 0; i < iterations; ++i){
+                    sim->determinize();
+                    iterate(root);
+                }
+                root_moves.clear();
+                for(uint32_t i = nodes[root].first_edge; i < nodes[root].first_edge + nodes[root].nedges; ++i)
+                    root_moves.emplace_back(edges[i].move, edges[i].eval);
+            }
+            Move best() const{ return best_root_move(root_moves); }
+        };
+    }
+}
+
+#endif //CPPJIEQI_ISMCTS_H
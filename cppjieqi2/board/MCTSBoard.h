@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <unordered_map>
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
 #include <utility>
 #include <string>
@@ -36,26 +37,34 @@ namespace board {
                 while(gen >= quplim) gen = rand();
                 return (gen % upper_lim) + lower_lim;
             }
+            double uniform() noexcept { // [0, 1)
+                return (rand() >> 11) * (1.0 / 9007199254740992.0);
+            }
             template<class T> inline void shuffle(T start, T end){
                 std::shuffle(start, end, rand);
             }
         };
+        //进程共享的那一个, 只给没传Randomizer的老代码用; 多线程搜索时每个模拟器要有自己的Randomizer
         using RNG = Singleton<Randomizer>;
 
         struct Move{
             uint8_t from, to;
         };
-        struct MoveDesc{
-            int8_t offset, preq, rep, type;
-            MoveDesc(int offset, int preq, int rep, int type): offset(offset), preq(preq), rep(rep), type(type){}
-            // offset: genmove(pos -> pos + offset)
-            // preq: if(preq!=offset) board[pos + preq] = '.' |- genmove(pos -> pos + offset)
-            // rep : if(rep) for(i=1; board[pos + i*offset]=='.'; ++i) genmove(pos -> pos + i*offset)
-            // type: if(type&1){ for(++i; board[pos + i*offset]=='.'; ++i); } genmove(pos -> pos + i*offset)
-            //       if(type&2) pos + offset is restricted |- genmove(pos -> pos + offset)
-            //       if(type&4) pos < 128 |- genmove(pos -> pos + offset)
-        };
         static constexpr int NORTH = -16, EAST = 1, SOUTH = 16, WEST = -1;
+
+        // 着法表, 编译期就定好. 顺序就是生成着法的顺序(MCTS的结果和着法顺序有关, 不要改)
+        struct Leap{
+            int8_t offset, leg; // 走到pos + offset, board[pos + leg]上有子就走不了(蹩马腿/塞象眼)
+        };
+        static constexpr int ORTH[4] = {NORTH, EAST, SOUTH, WEST};
+        static constexpr int DIAG[4] = {NORTH + EAST, EAST + SOUTH, SOUTH + WEST, WEST + NORTH};
+        static constexpr Leap KNIGHT_LEAPS[8] = {
+                {2 * NORTH + WEST, NORTH}, {2 * NORTH + EAST, NORTH},
+                {2 * EAST + NORTH, EAST}, {2 * EAST + SOUTH, EAST},
+                {2 * SOUTH + EAST, SOUTH}, {2 * SOUTH + WEST, SOUTH},
+                {2 * WEST + SOUTH, WEST}, {2 * WEST + NORTH, WEST}};
+        static constexpr Leap BISHOP_LEAPS[4] = {
+                {2 * DIAG[0], DIAG[0]}, {2 * DIAG[1], DIAG[1]}, {2 * DIAG[2], DIAG[2]}, {2 * DIAG[3], DIAG[3]}};
         static constexpr int A9 = 51, I0 = 203, BOARD_SIZE = 256;
 
         struct XiangqiPieceData{
@@ -98,8 +107,6 @@ namespace board {
             unsigned char display_name[128][16];
             unsigned char piece_type[128];
             uint64_t zobrist_table[30][256]={};
-            static constexpr int dir[4] = {NORTH, EAST, SOUTH, WEST};
-            vector<MoveDesc> valid_moves[16];
 
             XiangqiPieceData():display_name(), piece_type(){
                 const pair<unsigned char, string> _uni_pieces[] = {
@@ -137,7 +144,6 @@ namespace board {
                 mt19937_64 zobrist_gen(0xf80821f01eefd21dul); // a random seed got from random.org
                 for(int i=0;i<30;++i){
                     int index = _uni_pieces[i].first;
-                    char piece = _uni_pieces[i].first;
                     piece_type[index] = i;
                     strcpy((char*)display_name[index], _uni_pieces[i].second.c_str());
                     if(i>1){
@@ -146,38 +152,9 @@ namespace board {
                         for(int x=3;x<13;++x)
                             for(int y=3;y<12;++y)
                                 zobrist_table[i][x<<4 | y]=zobrist_gen();
-                        if(i<15){
-                            for(int d = 0; d<4; ++d){
-                                int base_offset = dir[d];
-                                if(piece == 'A' || piece == 'B' || piece == 'F' || piece == 'G') // 士, 相, 暗象, 暗仕
-                                    base_offset += dir[(d+1)&3];
-                                int final_offset = base_offset;
-                                if(piece == 'B' || piece == 'F' || piece == 'E' || piece == 'N') // 相, 暗象, 暗马, 马
-                                    final_offset += base_offset;
-                                if(piece == 'E' || piece == 'N'){
-                                    valid_moves[i].emplace_back(final_offset + dir[(d-1)&3], base_offset, 0, 0);
-                                    valid_moves[i].emplace_back(final_offset + dir[(d+1)&3], base_offset, 0, 0);
-                                }else{
-                                    MoveDesc md(final_offset, base_offset, 0, 0);
-                                    if(piece == 'G' || piece == 'K') md.type = 2; // 暗仕, 帅
-                                    if(piece == 'C' || piece == 'H') md.type = 1; // 炮, 暗炮
-                                    if(piece == 'C' || piece == 'H' || piece == 'R' || piece == 'D' ) // 炮, 暗炮, 车, 暗车
-                                        md.rep = 1;
-                                    if(piece == 'P' || piece == 'I'){ // 卒, 暗卒
-                                        if(d!=2){
-                                            if(d!=0) md.type = 4;
-                                            valid_moves[i].push_back(md);
-                                        }
-                                    }else valid_moves[i].push_back(md);
-                                }
-                            }
-                        }
                     }
                 }
             }
-            const vector<MoveDesc>& get_moves(unsigned char piece){
-                return valid_moves[piece_type[piece]];
-            }
             inline uint64_t get_zobrist(unsigned char piece, int index) const {
                 return zobrist_table[piece_type[piece]][index];
             }
@@ -185,7 +162,7 @@ namespace board {
                 return zobrist_table[piece_type[piece]][pos];
             }
         };
-        using GameData = Singleton<XiangqiPieceData>;
+        using GameData = Singleton<XiangqiPieceData>; //静态初始化时建好, 之后只读, 可以跨线程共享
 
         inline bool is_piece(unsigned char piece){ return piece & 64u; }
         inline bool is_self(unsigned char piece){ return (piece & 96u) == 64u; }
@@ -200,8 +177,8 @@ namespace board {
         struct alignas(16) BelieveState{
             constexpr static int max_remaining = 15 + 1;
             unsigned char remaining[max_remaining];
-            inline unsigned char get() noexcept {
-                return remaining[RNG::get()->sample(remaining[0])+1];
+            inline unsigned char get(Randomizer& rng) noexcept {
+                return remaining[rng.sample(remaining[0])+1];
             }
             inline void remove(char t) noexcept {
                 for(int i=1;i<=remaining[0];++i) if(remaining[i] == t){
@@ -218,6 +195,7 @@ namespace board {
                     result ^= zobrist_source->get_zobrist(remaining[i], i);
                 return result;
             }
+            BelieveState() = default; // 不初始化, 给模拟器里定长的栈用
             explicit BelieveState(const char* initial_believe):remaining(){
                 remaining[0] = strlen(initial_believe);
                 memcpy(remaining+1, initial_believe, remaining[0]);
@@ -230,7 +208,7 @@ namespace board {
             }
         };
         struct MCTSBoard {
-            using BelieveState = BelieveState;
+            using BelieveState = _MCTS::BelieveState;
             char board[BOARD_SIZE];
             BelieveState self_covered, oppo_covered;
             uint64_t board_zobrist, bs_zobrist;
@@ -385,43 +363,68 @@ namespace board {
                 }
                 os << "   a b c d e f g h i\n\n";
             }
+            // 对pos上自己的子piece能走到的每个格子to调用f(to), 按子的种类分开走, 不查表里的标记
+            // 车炮滑动时to可能是空格'.', 碰到的子和边界外的' '也会传给f, 能不能走由f判断; f返回true就停下, 返回true
+            template<class F> bool for_each_target(int pos, unsigned char piece, F&& f) const{
+                switch(piece){
+                    case 'R': case 'D': // 车, 暗车
+                        for(const int d: ORTH){
+                            int topos = pos + d;
+                            for(;board[topos]=='.';topos+=d) if(f(topos)) return true;
+                            if(f(topos)) return true;
+                        }
+                        return false;
+                    case 'C': case 'H': // 炮, 暗炮
+                        for(const int d: ORTH){
+                            int topos = pos + d;
+                            for(;board[topos]=='.';topos+=d) if(f(topos)) return true;
+                            for(topos+=d;board[topos]=='.';topos+=d);
+                            if(f(topos)) return true;
+                        }
+                        return false;
+                    case 'N': case 'E': // 马, 暗马
+                        for(const Leap& q: KNIGHT_LEAPS)
+                            if(!is_piece(board[pos + q.leg]) && f(pos + q.offset)) return true;
+                        return false;
+                    case 'B': case 'F': // 相, 暗相(翻开的相可以过河)
+                        for(const Leap& q: BISHOP_LEAPS)
+                            if(!is_piece(board[pos + q.leg]) && f(pos + q.offset)) return true;
+                        return false;
+                    case 'A': // 翻开的仕可以出九宫
+                        for(const int d: DIAG) if(f(pos + d)) return true;
+                        return false;
+                    case 'G': // 暗仕
+                        for(const int d: DIAG) if(XiangqiPieceData::restricted_area[pos + d] == '_' && f(pos + d)) return true;
+                        return false;
+                    case 'K':{
+                        int topos = pos + NORTH; // 将帅照面, 和裁判一样可以直接吃将
+                        for(;board[topos]=='.';topos+=NORTH);
+                        if(board[topos] == 'k' && f(topos)) return true;
+                        for(const int d: ORTH) if(XiangqiPieceData::restricted_area[pos + d] == '_' && f(pos + d)) return true;
+                        return false;
+                    }
+                    case 'P': case 'I': // 兵, 暗兵: 过了河才能横走
+                        if(f(pos + NORTH)) return true;
+                        if(pos < 128 && (f(pos + EAST) || f(pos + WEST))) return true;
+                        return false;
+                    default:
+                        return false;
+                }
+            }
             int generate_valid_moves(){
-                auto database = Singleton<XiangqiPieceData>::get();
                 int count = 0;
                 mate = false;
-                auto genmove=[&](int from, int to){
-                    if(board[to]!=' ' && !is_self(board[to])) {
-                        moves[count++] = (Move) {(uint8_t) from, (uint8_t) to};
-                        if(board[to] == 'k') mate = true;
-                    }
-                };
                 for(int x=3;x<13;++x)
                     for(int y=3;y<12;++y){
-                        int pos = x<<4 | y;
-                        unsigned char piece = board[pos];
-                        if(is_self(piece)){
-                            auto moves = database->get_moves(piece);
-                            for(const auto&q:moves){
-                                if(q.preq != q.offset) {
-                                    if (!is_piece(board[pos + q.preq]))
-                                        genmove(pos, pos + q.offset);
-                                }else{
-                                    int off = q.offset;
-                                    int topos = pos + off;
-                                    if(q.rep){
-                                        for(;board[topos]=='.';topos+=off) genmove(pos, topos);
-                                        if(q.type == 1){ // cannon
-                                            for(topos+=off;board[topos]=='.';topos+=off);
-                                            genmove(pos, topos);
-                                        }else genmove(pos, topos);
-                                    }else if(q.type == 2){
-                                        if(XiangqiPieceData::restricted_area[topos] == '_') genmove(pos, topos);
-                                    }else if(q.type == 4){
-                                        if(topos < 128) genmove(pos, topos); // on opponent side
-                                    }else genmove(pos, topos);
-                                }
+                        const int pos = x<<4 | y;
+                        if(!is_self(board[pos])) continue;
+                        for_each_target(pos, board[pos], [&](int to) -> bool {
+                            if(board[to]!=' ' && !is_self(board[to])) {
+                                moves[count++] = (Move) {(uint8_t) pos, (uint8_t) to};
+                                if(board[to] == 'k') mate = true;
                             }
-                        }
+                            return false;
+                        });
                     }
                 return count;
             }
@@ -431,34 +434,15 @@ namespace board {
                 // 2 => check mate
                 // 1 => check capture
                 // 0 => nothing
-                auto database = Singleton<XiangqiPieceData>::get();
                 int level = 0;
-                unsigned char piece = board[pos];
-                auto check = [&](int pos)->int{ if(is_oppo(board[pos])){ level = 1; if(board[pos]=='k') return 1; } return 0;};
-                if(is_self(piece)){
-                    auto moves = database->get_moves(piece);
-                    for(const auto&q:moves){
-                        if(q.preq != q.offset) {
-                            if (!is_piece(board[pos + q.preq]))
-                                if(check(pos + q.offset)) return 2;
-                        }else{
-                            int off = q.offset;
-                            int topos = pos + off;
-                            if(q.rep){
-                                for(;board[topos]=='.';topos+=off) if(check(topos)) return 2;
-                                if(q.type == 1){ // cannon
-                                    for(topos+=off;board[topos]=='.';topos+=off);
-                                    if(check(topos)) return 2;
-                                }else if(check(topos)) return 2;
-                            }else if(q.type == 2){
-                                if(XiangqiPieceData::restricted_area[topos] == '_') if(check(topos)) return 2;
-                            }else if(q.type == 4){
-                                if(topos < 128) if(check(topos)) return 2; // on opponent side
-                            }else if(check(topos)) return 2;
-                        }
+                const bool check_mate = for_each_target(pos, board[pos], [&](int to) -> bool {
+                    if(is_oppo(board[to])){
+                        level = 1;
+                        return board[to] == 'k';
                     }
-                }
-                return level;
+                    return false;
+                });
+                return check_mate ? 2 : level;
             }
             MCTSBoard(const MCTSBoard& oppo, bool revert): self_covered(oppo.oppo_covered, true), oppo_covered(oppo.self_covered, true){
                 // assert(revert == true)
@@ -0,0 +1,65 @@
+#ifndef CPPJIEQI_MCTSEVAL_H
+#define CPPJIEQI_MCTSEVAL_H
+
+#include <cmath>
+#include "MCTSGameSimulator.h"
+#include "../score/score.h"
+
+extern short pstglobal[5][PIECE_SLOTS][SQUARE_SLOTS]; //score.cpp里, AIBoard4用的是pstglobal[3]
+
+// DUCT截断rollout时给叶子打分, 用的是AIBoard4的子力位置表(main读score.conf进pstglobal[3])
+// 只用score.h, 不include board.h, 和MCTSBoard.h的宏不冲突
+namespace MCTSEval{
+    using namespace board::_MCTS;
+    static constexpr double discount_factor = 1.5; // 和AIBoard4一样, 暗子的均值要打折
+
+    // 行棋方视角的子力位置分(行棋方 - 对方). 明子查表, 暗子算它还可能是的子的表均值(AIBoard4::CalcVersion的AVERAGE_SLOT)
+    // 行棋方的棋盘是大写在下, 对方的子旋转180度查红方的表
+    inline int static_score(const MCTSSim::DeterminizedSimulator& sim){
+        const MCTSBoard& b = sim.turn ? sim.ply1 : sim.ply2;
+        const short (*pst)[SQUARE_SLOTS] = pstglobal[3];
+        auto dark_value = [pst](const BelieveState& bs) -> int {
+            if(!bs.remaining[0]) return 0;
+            int sum = 0;
+            for(int i=1;i<=bs.remaining[0];++i) sum += pst[PID(to_self(bs.remaining[i]))][AVERAGE_SLOT];
+            return (int)::round(sum / discount_factor / bs.remaining[0]);
+        };
+        const int self_dark = dark_value(b.self_covered), oppo_dark = dark_value(b.oppo_covered);
+        int score = 0;
+        for(int x=3;x<13;++x)
+            for(int y=3;y<12;++y){
+                const int pos = x<<4 | y;
+                const unsigned char p = b.board[pos];
+                if(!is_piece(p)) continue;
+                if(is_self(p)) score += is_dark(p) ? self_dark : pst[PID(p)][SQ(pos)];
+                else score -= is_dark(p) ? oppo_dark : pst[PID(to_self(p))][SQ(254 - pos)];
+            }
+        return score;
+    }
+
+    // 分数映射到[-1, 1], 和rollout的胜负一个量纲
+    inline double squash(int score, double scale){
+        return tanh(score / scale);
+    }
+
+    // 只走吃子的alpha-beta, 最多depth层, 返回行棋方视角[-1, 1]的分数; 能吃将算1
+    // 吃子以后不会重复局面也不会触发120步不吃子判和, 所以sim.move的返回值不用看
+    inline double quiescence(MCTSSim::DeterminizedSimulator* sim, double alpha, double beta, int depth, double scale){
+        const MCTSSim::MoveSpan moves = sim->generate_moves();
+        if(sim->turn ? sim->ply1.mate : sim->ply2.mate) return 1;
+        const double stand = squash(static_score(*sim), scale);
+        if(depth <= 0 || stand >= beta) return stand;
+        if(stand > alpha) alpha = stand;
+        for(const MCTSBoard::Move& move: moves){
+            if(!is_piece(sim->ply1.board[move.to])) continue; // 着法里目标格上有子就是吃子
+            sim->move(move.from, move.to);
+            const double val = -quiescence(sim, -beta, -alpha, depth - 1, scale);
+            sim->undo_move();
+            if(val >= beta) return val;
+            if(val > alpha) alpha = val;
+        }
+        return alpha;
+    }
+};
+
+#endif //CPPJIEQI_MCTSEVAL_H
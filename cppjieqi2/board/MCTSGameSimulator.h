@@ -5,41 +5,71 @@
 #ifndef CPPJIEQI_MCTSGAMESIMULATOR_H
 #define CPPJIEQI_MCTSGAMESIMULATOR_H
 
-#include <stack>
 #include <algorithm>
-#include <unordered_map>
+#include <cassert>
 #include "MCTSBoard.h"
 
 namespace MCTSSim{
     using namespace board::_MCTS;
-    using std::stack;
+    static constexpr int MAX_PLY = 1024; // 模拟器从构造起最多走这么多步(树的深度+rollout), 各个栈都按这个开
+    static constexpr int MAX_MOVES = 120; // 和MCTSBoard::moves一样大
+
+    // 定长的栈, 接口和std::stack一样, 放在模拟器里面, 走子悔棋不分配内存
+    template<class T, int N> struct PlyStack{
+        T data[N];
+        int n = 0;
+        void push(const T& x){ assert(n < N); data[n++] = x; }
+        void pop(){ --n; }
+        T& top(){ return data[n - 1]; }
+        const T& top() const{ return data[n - 1]; }
+        bool empty() const{ return !n; }
+        size_t size() const{ return n; }
+        const T& operator[](int i) const{ return data[i]; }
+    };
+
+    // generate_moves的结果: 指向模拟器里这一步的着法缓冲, 到同一步下一次generate_moves之前有效
+    struct MoveSpan{
+        const MCTSBoard::Move* first = nullptr;
+        int n = 0;
+        const MCTSBoard::Move* begin() const{ return first; }
+        const MCTSBoard::Move* end() const{ return first + n; }
+        size_t size() const{ return n; }
+        bool empty() const{ return !n; }
+        const MCTSBoard::Move& operator[](int i) const{ return first[i]; }
+    };
+
     struct DeterminizedSimulator{
         MCTSBoard ply1, ply2;
         BelieveState ply1_piece, ply2_piece;
 
-        unordered_map<uint64_t, int> state_counter;
+        PlyStack<uint64_t, MAX_PLY> zobrist_history; // 每一步走完的ply1.board_zobrist, 判重复局面用
 
         char det[256];
         bool turn;
+        Randomizer* rng; // 确定化和rollout用的随机数, 不同线程的模拟器不要共用
         struct BSObject{
             BelieveState ply1_self, ply1_oppo;
             BelieveState ply2_self, ply2_oppo;
         };
-        stack<BSObject> bsstack;
+        PlyStack<BSObject, MAX_PLY> bsstack;
 
         struct MoveResult{
             uint8_t from, to;
             uint8_t reveal, capture;
             uint8_t mate_level, ncap_count;
         };
-        stack<MoveResult> mvstack;
+        PlyStack<MoveResult, MAX_PLY> mvstack;
         static constexpr int unterminated = 114514;
-        stack<int> state_value;
+        PlyStack<int, MAX_PLY> state_value;
+        MCTSBoard::Move movebuf[MAX_PLY + 1][MAX_MOVES]; // 第i步的着法, 下标是mvstack.size()
         int value(int last_pos, const MoveResult&last){
             auto zob = ply1.board_zobrist;
+            // 吃子以后棋盘上的子少了, 不会和吃子前的局面重复, 只要往回看ncap_count步
             int t = 1;
-            if(state_counter.count(zob)) t=++state_counter[zob];
-            else state_counter[zob]=1;
+            const int n = zobrist_history.size();
+            for(int i = n - 1; i >= 0 && i >= n - last.ncap_count; --i)
+                t += zobrist_history[i] == zob;
+            zobrist_history.push(zob);
             if(last.capture == 'k') return 1;
             if(last.capture == 'K') return -1;
             if(last.ncap_count >= 120) return 0; // draw
@@ -55,29 +85,27 @@ namespace MCTSSim{
             }
             return unterminated;
         }
-        vector<MCTSBoard::Move> generate_moves(){
-            if(turn){
-                int nmoves = ply1.generate_valid_moves();
-                if(ply1.mate){
-                    for(int i=0;i<nmoves;++i)
-                        if(ply1.board[ply1.moves[i].to] == 'k')
-                            return {ply1.moves+i, ply1.moves+i+1};
-                }else return {ply1.moves, ply1.moves+nmoves};
+        MoveSpan generate_moves(){
+            MCTSBoard& b = turn ? ply1 : ply2;
+            MCTSBoard::Move* res = movebuf[mvstack.size()];
+            int nmoves = b.generate_valid_moves(), n = 0;
+            if(b.mate){
+                for(int i=0;i<nmoves;++i)
+                    if(b.board[b.moves[i].to] == 'k'){
+                        res[n++] = b.moves[i];
+                        break;
+                    }
             }else{
-                vector<MCTSBoard::Move> res;
-                int nmoves = ply2.generate_valid_moves();
-                // std::cout << std::endl;
-                if(ply2.mate){
-                    for(int i=0;i<nmoves;++i)
-                        if(ply2.board[ply2.moves[i].to] == 'k')
-                            res = {ply2.moves+i, ply2.moves+i+1};
-                }else res = {ply2.moves, ply2.moves+nmoves};
-                for(auto& move: res) {
-                    move.to = 254 - move.to;
-                    move.from = 254 - move.from;
+                memcpy(res, b.moves, nmoves * sizeof(MCTSBoard::Move));
+                n = nmoves;
+            }
+            if(!turn){
+                for(int i=0;i<n;++i) {
+                    res[i].to = 254 - res[i].to;
+                    res[i].from = 254 - res[i].from;
                 }
-                return res;
             }
+            return {res, n};
         }
         int move(int from, int to){
             auto res = ply1.move(from, to);
@@ -111,7 +139,7 @@ namespace MCTSSim{
             auto t = mvstack.top();
             mvstack.pop();
             state_value.pop();
-            state_counter[ply1.board_zobrist]--;
+            zobrist_history.pop();
             MCTSBoard::Move_Result mr{t.reveal, t.capture};
             ply1.undo_move(t.to, t.from, mr);
             if(mr.reveal) mr.reveal^=32;
@@ -129,8 +157,8 @@ namespace MCTSSim{
         }
 
         void determinize(){
-            RNG::get()->shuffle(ply1_piece.remaining+1, ply1_piece.remaining+1+ply1_piece.remaining[0]);
-            RNG::get()->shuffle(ply2_piece.remaining+1, ply2_piece.remaining+1+ply2_piece.remaining[0]);
+            rng->shuffle(ply1_piece.remaining+1, ply1_piece.remaining+1+ply1_piece.remaining[0]);
+            rng->shuffle(ply2_piece.remaining+1, ply2_piece.remaining+1+ply2_piece.remaining[0]);
             int ply1idx = 1, ply2idx = 1;
             for(int x=3;x<13;++x)
                 for(int y=3;y<12;++y){
@@ -145,6 +173,19 @@ namespace MCTSSim{
         void set_det(int pos, char revealed){
             det[pos] = revealed;
         }
+        // 真正下了一步(不是搜索里的试走): 暗子翻出什么、吃掉的暗子是什么都是看到的, 写进det再走,
+        // 翻出来的子从这一方的暗子池里去掉, 之后determinize只在剩下的子里抽; 吃掉的暗子不知道是什么时传0, 池子不变
+        int play(int from, int to, char revealed, char captured = 0){
+            if(revealed){
+                det[from] = revealed;
+                if(is_self(revealed)) ply1_piece.remove(revealed); else ply2_piece.remove(revealed);
+            }
+            if(captured){
+                det[to] = captured;
+                if(is_self(captured)) ply1_piece.remove(captured); else ply2_piece.remove(captured);
+            }
+            return move(from, to);
+        }
         void print(std::ostream& os = std::cout){
             MCTSBoard::Move lastMove[1] = {};
             if(!mvstack.empty()){
@@ -178,8 +219,8 @@ namespace MCTSSim{
             }
             os << "   a b c d e f g h i\n\n";
         }
-        DeterminizedSimulator(const MCTSBoard& board, bool turn):ply1(board), ply2(board, true), ply1_piece(board.self_covered),
-                                                      ply2_piece(board.oppo_covered),det(), turn(turn){
+        DeterminizedSimulator(const MCTSBoard& board, bool turn, Randomizer* rng = RNG::get()):ply1(board), ply2(board, true), ply1_piece(board.self_covered),
+                                                      ply2_piece(board.oppo_covered),det(), turn(turn), rng(rng){
             memset(det, '.', sizeof det);
         }
     };
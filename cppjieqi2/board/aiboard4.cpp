@@ -90,7 +90,7 @@ board::AIBoard4::AIBoard4(const char another_state[MAX], bool turn, int round, c
     }else{
         rotate(state_red);
     }
-    copy_pst(this -> pst, ::pstglobal[3]);
+    this -> pst = ::pstglobal[3];
     CopyData(di);
     _initialize_dir();
     _initialize_zobrist();
@@ -201,8 +201,8 @@ bool board::AIBoard4::Move(const unsigned char encode_from, const unsigned char
             case 'r': --che_opponent; break;
             case 'p': --zu_opponent; break;
         }
-        zobrist_hash ^= zobrist[(int)state_red[encode_to]][encode_to];
-        zobrist_hash ^= zobrist[(int)state_red[encode_from]][encode_from];
+        zobrist_hash ^= zobrist[SID(state_red[encode_to])][SQ(encode_to)];
+        zobrist_hash ^= zobrist[SID(state_red[encode_from])][SQ(encode_from)];
         if(state_red[encode_from] >= 'D' && state_red[encode_from] <= 'I'){
             state_red[encode_to] = 'U';
             state_black[reverse_encode_to] = 'u';
@@ -212,15 +212,15 @@ bool board::AIBoard4::Move(const unsigned char encode_from, const unsigned char
         }
         state_red[encode_from] = '.';
         state_black[reverse_encode_from] = '.';
-        zobrist_hash ^= zobrist[(int)state_red[encode_to]][encode_to];
+        zobrist_hash ^= zobrist[SID(state_red[encode_to])][SQ(encode_to)];
     } else{
         cache.push({encode_from, encode_to, state_black[encode_to]});
         switch(state_black[encode_to]){
             case 'r': --che_opponent; break;
             case 'p': --zu_opponent; break;
         }
-        zobrist_hash ^= zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
-        zobrist_hash ^= zobrist[(int)state_red[reverse_encode_from]][reverse_encode_from];
+        zobrist_hash ^= zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
+        zobrist_hash ^= zobrist[SID(state_red[reverse_encode_from])][SQ(reverse_encode_from)];
         if(state_black[encode_from] >= 'D' && state_black[encode_from] <= 'I'){
             state_black[encode_to] = 'U';
             state_red[reverse_encode_to] = 'u';
@@ -230,7 +230,7 @@ bool board::AIBoard4::Move(const unsigned char encode_from, const unsigned char
         }
         state_black[encode_from] = '.';
         state_red[reverse_encode_from] = '.';
-        zobrist_hash ^= zobrist[(int)state_red[reverse_encode_to]][reverse_encode_to];
+        zobrist_hash ^= zobrist[SID(state_red[reverse_encode_to])][SQ(reverse_encode_to)];
     }
     turn = !turn;
     std::swap(che, che_opponent);
@@ -421,7 +421,7 @@ short board::AIBoard4::ScanProtectors(){
     const short delta = 10;
     for(int i = 0; i < 20; ++i){
         if(_state_pointer[penaltyareaoppo[i]] == 'P'){
-            short tmp = (delta * (4 - L1[penaltyareaoppo[i]][71]) * oppo);
+            short tmp = (delta * (4 - L1[SQ(penaltyareaoppo[i])][SQ(71)]) * oppo);
             if(penaltyareaoppo[i] <= 57){
                 //底兵
                 tmp /= 2;
@@ -430,7 +430,7 @@ short board::AIBoard4::ScanProtectors(){
             bonus += tmp;
         }
         if(_state_pointer[penaltyarea[i]] == 'p'){
-            short tmp = (delta * (4 - L1[penaltyarea[i]][183]) * myself);
+            short tmp = (delta * (4 - L1[SQ(penaltyarea[i])][SQ(183)]) * myself);
             if(penaltyarea[i] >= 197){
                 tmp /= 2;
             }
@@ -622,6 +622,7 @@ bool board::AIBoard4::GenMovesWithScore(scoretuple legal_moves[MAX_POSSIBLE_MOVE
     }
     return false;
 }//GenMovesWithScore()
+template bool board::AIBoard4::GenMovesWithScore<false>(scoretuple legal_moves[MAX_POSSIBLE_MOVES], int& num_of_legal_moves, std::pair<unsigned char, unsigned char>* killer, short& killer_score, unsigned char& mate_src, unsigned char& mate_dst, bool& killer_is_alive); //perft.cpp要用
 
 
 template<bool doublereverse>
@@ -702,13 +703,13 @@ void board::AIBoard4::CalcVersion(const int ver){
     if(numr > 0){
         double sumr = 0.0;
         for(const char c : MINGZI){
-            sumr += pst[(int)c][0] * aidi[ver][1][(int)c] / discount_factor;
+            sumr += pst[PID(c)][AVERAGE_SLOT] * aidi[ver][1][(int)c] / discount_factor;
         }
-        aiaverage[ver][1][0][0] = ::round(sumr / numr);
-        for(int i = 51; i <= 203; ++i){
+        aiaverage[ver][1][0][AVERAGE_SLOT] = ::round(sumr / numr);
+        for(int i = 0; i < SQUARE_NUM; ++i){
             sumr = 0.0;
             for(const char c : MINGZI){
-                sumr += pst[(int)c][i] * aidi[ver][1][(int)c];
+                sumr += pst[PID(c)][i] * aidi[ver][1][(int)c];
             }
             aiaverage[ver][1][1][i] = ::round(sumr / numr);
         }
@@ -716,13 +717,13 @@ void board::AIBoard4::CalcVersion(const int ver){
     if(numb > 0){
         double sumb = 0.0;
         for(const char c : MINGZI){
-            sumb += pst[(int)c][0] * aidi[ver][0][((int)c)^32] / discount_factor;
+            sumb += pst[PID(c)][AVERAGE_SLOT] * aidi[ver][0][((int)c)^32] / discount_factor;
         }
-        aiaverage[ver][0][0][0] = ::round(sumb / numb);
-        for(int i = 51; i <= 203; ++i){
+        aiaverage[ver][0][0][AVERAGE_SLOT] = ::round(sumb / numb);
+        for(int i = 0; i < SQUARE_NUM; ++i){
             sumb = 0.0;
             for(const char c : MINGZI){
-                sumb += pst[(int)c][i] * aidi[ver][0][((int)c)^32];
+                sumb += pst[PID(c)][i] * aidi[ver][0][((int)c)^32];
             }
             aiaverage[ver][0][1][i] = ::round(sumb / numb);
         }
@@ -831,13 +832,13 @@ inline short complicated_score_function4(board::AIBoard4* self, const char* stat
         return MATE_UPPER;
     }
     if(p == 'R' || p == 'N' || p == 'B' || p == 'A' || p == 'K' || p == 'C' || p == 'P'){
-        score =  bp -> pst[intp][dst] -  bp -> pst[intp][src];
+        score =  bp -> pst[PID(intp)][SQ(dst)] -  bp -> pst[PID(intp)][SQ(src)];
     }
     
     else{
-        score = bp -> aiaverage[version][turn][1][dst] - bp -> aiaverage[version][turn][0][0];
+        score = bp -> aiaverage[version][turn][1][SQ(dst)] - bp -> aiaverage[version][turn][0][AVERAGE_SLOT];
         float che_zu_possibility = bp -> aisumall[version][turn] > 0 ? (bp -> aidi[version][turn][che_char] + bp -> aidi[version][turn][zu_char])/bp -> aisumall[version][turn] : 0.0;
-        float scorediff = bp -> aiaverage[version][turn][0][0] * che_zu_possibility;
+        float scorediff = bp -> aiaverage[version][turn][0][AVERAGE_SLOT] * che_zu_possibility;
         if(p == 'D'){
             score -= (30 * (possible_che_opponent/2 + bp -> che_opponent - (q == 'R')));
         }else if(p == 'E'){
@@ -923,7 +924,7 @@ inline short complicated_score_function4(board::AIBoard4* self, const char* stat
         }else if(p == 'H'){
 
             if(src == 164 && dst == 68 && state_pointer[52] == 'e'){
-                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][0]/2);
+                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][AVERAGE_SLOT]/2);
                 score += bonus/2;
                 if(state_pointer[53] != '.'){ //python BUG
                     score += bonus;
@@ -934,7 +935,7 @@ inline short complicated_score_function4(board::AIBoard4* self, const char* stat
             }
             
             if(src == 170 && dst == 74 && state_pointer[58] == 'e'){
-                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][0]/2);
+                short bonus = ::round(zu_possibility * bp -> aiaverage[version][turn][0][AVERAGE_SLOT]/2);
                 score += bonus/2;
                 if(state_pointer[57] != '.'){ //python BUG
                     score += bonus;
@@ -962,13 +963,13 @@ inline short complicated_score_function4(board::AIBoard4* self, const char* stat
     if(q >= 'A' && q <= 'Z'){
         int k = 254 - dst;
         if(q == 'R' || q == 'N' || q == 'B' || q == 'A' || q == 'C' || q == 'P'){
-            score +=  bp -> pst[intq][k];
+            score +=  bp -> pst[PID(intq)][SQ(k)];
         }
         else{
             if(q != 'U'){
-                score += bp -> aiaverage[version][1 - turn][0][0];            
+                score += bp -> aiaverage[version][1 - turn][0][AVERAGE_SLOT];            
             }else{
-                score += bp -> aiaverage[version][1 - turn][1][k];
+                score += bp -> aiaverage[version][1 - turn][1][SQ(k)];
             }
             if(q == 'D'){
                 score +=  30 * (possible_che/2 + bp -> che);               
@@ -1039,7 +1040,7 @@ std::string thinker4(board::AIBoard4* bp, int maxdepth){
         bp -> moves.clear();
         short score = alphabeta4(bp, -MATE_UPPER, MATE_UPPER, depth, ROOT, true, true, src, dst);
         size_t int_ms = (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
-        if(score > BAN_VALUE || depth == maxdepth){
+        if(score > BAN_VALUE || bp -> limits.Stop(depth, maxdepth, bp -> search_nodes, int_ms)){
             if(depth <= 6){
                 calleval4(bp, -MATE_UPPER, MATE_UPPER, {2, 4}, true, src, dst);
             }
@@ -1054,12 +1055,12 @@ std::string thinker4(board::AIBoard4* bp, int maxdepth){
                 bp -> GenMovesWithScore<true>(legal_moves_tmp, num_of_legal_moves_tmp, NULL, killer_score, mate_src, mate_dst, killer_is_alive);
                 src = SRC(legal_moves_tmp[0]);
                 dst = DST(legal_moves_tmp[0]);
-                std::cout << "My name: " << bp -> GetName() <<" [AM I FAILED?]" << num_of_legal_moves_tmp << " My move: " << bp -> translate_ucci(src, dst) << ", duration = " << int_ms << ", depth = " << depth << "." << std::endl;
+                std::cout << "My name: " << bp -> GetName() <<" [AM I FAILED?]" << num_of_legal_moves_tmp << " My move: " << bp -> translate_ucci(src, dst) << ", duration = " << int_ms << ", depth = " << depth << ", nodes = " << bp -> search_nodes << "." << std::endl;
                 if(num_of_legal_moves_tmp != 0){
                     return bp -> translate_ucci(src, dst);
                 }
             }
-            std::cout << "My name: " << bp -> GetName()  << " My move: " << bp -> translate_ucci(move.first, move.second) << ", duration = " << int_ms << ", depth = " << depth << "." << std::endl;
+            std::cout << "My name: " << bp -> GetName()  << " My move: " << bp -> translate_ucci(move.first, move.second) << ", duration = " << int_ms << ", depth = " << depth << ", nodes = " << bp -> search_nodes << "." << std::endl;
             return bp -> translate_ucci(move.first, move.second);
         }
     }
@@ -1068,6 +1069,7 @@ std::string thinker4(board::AIBoard4* bp, int maxdepth){
 
 
 short alphabeta4(board::AIBoard4* self, short alpha, short beta, int depth, int type, const bool nullmove, const bool nullmovenow, unsigned char& argmaxsrc, unsigned char& argmaxdst){
+    ++self -> search_nodes;
     if(type == ROOT){
         self -> original_depth = depth;
         self -> ply = 0;
@@ -1301,11 +1303,11 @@ void _inner_recur(board::AIBoard4* self, const int ver, std::unordered_map<unsig
                         --self -> aidi[ver][turn][intchar];
                         uint32_t zobrist_before = self -> zobrist_hash;
                         int zobrist_key = turn ? key : 254 - key;
-                        self -> zobrist_hash ^= self -> zobrist[(int)self -> state_red[zobrist_key]][zobrist_key];
+                        self -> zobrist_hash ^= self -> zobrist[SID(self -> state_red[zobrist_key])][SQ(zobrist_key)];
                         state_pointer[key] = c;
                         state_pointer_oppo[254 - key] = self -> swapcase(c);
-                        self -> zobrist_hash ^= self -> zobrist[(int)self -> state_red[zobrist_key]][zobrist_key];
-                        short score_diff = self -> pst[(int)c][key] - self -> aiaverage[ver-1][turn][1][key];
+                        self -> zobrist_hash ^= self -> zobrist[SID(self -> state_red[zobrist_key])][SQ(zobrist_key)];
+                        short score_diff = self -> pst[PID(c)][SQ(key)] - self -> aiaverage[ver-1][turn][1][SQ(key)];
                         _inner_recur(self, ver, uncertainty_dict, uncertainty_keys, result_dict, counter_dict, index+1, me*(self -> aidi[ver][turn][intchar] + 1), op, score + score_diff/2, alpha, beta, depths, \
                             nullmove, argmaxsrc, argmaxdst);
                         state_pointer[key] = 'U';
@@ -1324,11 +1326,11 @@ void _inner_recur(board::AIBoard4* self, const int ver, std::unordered_map<unsig
                         --self -> aidi[ver][notturn][intchar];
                         uint32_t zobrist_before = self -> zobrist_hash;
                         int zobrist_key = turn ? key : 254 - key;
-                        self -> zobrist_hash ^= self -> zobrist[(int)self -> state_red[zobrist_key]][zobrist_key];
+                        self -> zobrist_hash ^= self -> zobrist[SID(self -> state_red[zobrist_key])][SQ(zobrist_key)];
                         state_pointer[key] = self -> swapcase(c);
                         state_pointer_oppo[254 - key] = c;
-                        self -> zobrist_hash ^= self -> zobrist[(int)self -> state_red[zobrist_key]][zobrist_key];
-                        short score_diff = self -> pst[(int)c][254 - key] - self -> aiaverage[ver-1][notturn][1][254 - key];
+                        self -> zobrist_hash ^= self -> zobrist[SID(self -> state_red[zobrist_key])][SQ(zobrist_key)];
+                        short score_diff = self -> pst[PID(c)][SQ(254 - key)] - self -> aiaverage[ver-1][notturn][1][SQ(254 - key)];
                         _inner_recur(self, ver, uncertainty_dict, uncertainty_keys, result_dict, counter_dict, index+1, me, op*(self -> aidi[ver][notturn][intchar] + 1), score-score_diff/2, alpha, beta, depths, \
                             nullmove, argmaxsrc, argmaxdst);
                         state_pointer[key] = 'u';
@@ -1389,4 +1391,30 @@ short eval4(board::AIBoard4* self, const int ver, const short alpha, const short
 short calleval4(board::AIBoard4* self, short alpha, short beta, std::vector<int> depths, const bool nullmove, unsigned char& argmaxsrc, unsigned char& argmaxdst){
     memset(self -> original_turns, self -> turn, sizeof(self -> original_turns));
     return eval4(self, 0, alpha, beta, depths, nullmove, argmaxsrc, argmaxdst);
-}
\ No newline at end of file
+}
+
+std::vector<std::string> scored_moves4(const char another_state[MAX], bool turn, const unsigned char di[5][2][123], tp* tptable, bool* mate){
+    std::unordered_map<std::string, bool> hist;
+    board::AIBoard4 ai(another_state, turn, 1, di, 0, tptable, &hist);
+    scoretuple legal_moves[MAX_POSSIBLE_MOVES];
+    int num_of_legal_moves = 0;
+    short killer_score = 0;
+    unsigned char mate_src = 0, mate_dst = 0;
+    bool killer_is_alive = false;
+    ai.Scan();
+    *mate = ai.GenMovesWithScore<true>(legal_moves, num_of_legal_moves, NULL, killer_score, mate_src, mate_dst, killer_is_alive);
+    std::vector<std::string> ret;
+    for(int i = 0; i < num_of_legal_moves; ++i){
+        const unsigned char src = SRC(legal_moves[i]), dst = DST(legal_moves[i]);
+        if(ai.getstatepointer()[dst] == 'k'){
+            continue;
+        }
+        ai.Move(src, dst, SCORE(legal_moves[i]));
+        const bool suicide = ai.Mate<false>(); //走完被对方吃帅
+        ai.UndoMove(1);
+        if(!suicide){
+            ret.push_back(ai.translate_ucci(src, dst));
+        }
+    }
+    return ret;
+}
@@ -19,7 +19,6 @@
 #define ROOT 0
 #define PV 1
 #define CUT 2
-extern unsigned char L1[256][256];
 #include <cstddef>
 #include <vector>
 #include <string>
@@ -204,10 +203,11 @@ typedef void(*KONGTOUPAO_SCORE4)(board::AIBoard4* bp, short* kongtoupao_score, s
 typedef std::string(*THINKER4)(board::AIBoard4* bp, int maxdepth);
 void register_score_functions4();
 std::string SearchScoreFunction4(void* score_func, int type);
-extern short pstglobal[5][123][256];
+extern short pstglobal[5][PIECE_SLOTS][SQUARE_SLOTS];
+extern unsigned char L1[SQUARE_SLOTS][SQUARE_SLOTS];
+extern uint64_t zobrist_table[SYMBOL_NUM][SQUARE_SLOTS];
 template <typename K, typename V>
 extern V GetWithDefUnordered(const std::unordered_map<K,V>& m, const K& key, const V& defval);
-extern void copy_pst(short dst[][256], short src[][256]);
 
 struct debugtuple{
     std::string ucci;
@@ -231,7 +231,7 @@ namespace board{
 class AIBoard4 : public Thinker{
 public:
     static bool has_initialized;
-    short aiaverage[VERSION_MAX][2][2][256];
+    short aiaverage[VERSION_MAX][2][2][SQUARE_SLOTS];
     unsigned char aisumall[VERSION_MAX][2];
     unsigned char aidi[VERSION_MAX][2][123];
     std::vector<bool> lastinserts;\
@@ -263,7 +263,7 @@ public:
     char state_black[MAX];
     std::stack<std::tuple<unsigned char, unsigned char, char>> cache;
     short score;//局面分数
-    short pst[123][256];
+    const short (*pst)[SQUARE_SLOTS]; //指向pstglobal, 只读
 
     struct gameinfo{
        unsigned char che;
@@ -310,7 +310,7 @@ public:
     std::string DebugPrintPos() const;
     void print_raw_board(const char* board, const char* hint);
     template<typename... Args> void print_raw_board(const char* board, const char* hint, Args... args);
-    uint64_t zobrist[123][256];
+    const uint64_t (*zobrist)[SQUARE_SLOTS]; //指向zobrist_table, 只读
     #if DEBUG
     std::vector<std::string> debug_flags;
     int movecounter=0;
@@ -319,7 +319,7 @@ public:
         uint64_t theoretical_hash = 0;
         for(int j = 51; j <= 203; ++j){
             if(::isalpha(state_red[j])){
-                theoretical_hash ^= zobrist[(int)state_red[j]][j];
+                theoretical_hash ^= zobrist[SID(state_red[j])][SQ(j)];
             }
         }
         return theoretical_hash;
@@ -417,13 +417,6 @@ public:
        return translate_single(std::get<1>(t)) + translate_single(std::get<2>(t));
     };
 
-    std::function<uint64_t(void)> randU64 = []() -> uint64_t{
-	   //BUG: 在Windows上每次生成同样的随机数
-       std::mt19937_64 gen(std::random_device{}());
-       uint64_t randomNumber = gen();
-       return randomNumber;
-    };
-
     template<typename T>
     inline T div(T x, T y){
         if(std::is_floating_point<T>::value){
@@ -597,19 +590,10 @@ private:
         return ret;
     };
     std::function<void(void)> _initialize_zobrist = [this](){
-        for(int i = 0; i < 123; ++i){
-            for(int j = 0; j < 256; ++j){
-                if(i != '.'){
-                    zobrist[i][j] = randU64();
-				}
-                else{
-                    zobrist[i][j] = 0;
-                }
-            }
-        }
+        zobrist = ::zobrist_table;
         for(int j = 51; j <= 203; ++j){
             if(::isalpha(state_red[j])){
-                zobrist_hash ^= zobrist[(int)state_red[j]][j];
+                zobrist_hash ^= zobrist[SID(state_red[j])][SQ(j)];
             }
         }
     };
@@ -629,4 +613,6 @@ void _inner_recur(board::AIBoard4* self, const int ver, std::unordered_map<unsig
 short eval4(board::AIBoard4* self, const int ver, const short alpha, const short beta, std::vector<int>& depths, const bool nullmove, unsigned char& argmaxsrc, unsigned char& argmaxdst);
 short calleval4(board::AIBoard4* self, short alpha, short beta, std::vector<int> depths, const bool nullmove, unsigned char& argmaxsrc, unsigned char& argmaxdst);
 void debugset(board::AIBoard4* self);
+//行棋方视角的局面下按走法生成的分数从高到低排好的全部着法(ucci, 黑方是黑方视角), 不含吃帅和送帅, mate返回能不能吃帅; bench用它走出测试局面
+std::vector<std::string> scored_moves4(const char another_state[MAX], bool turn, const unsigned char di[5][2][123], tp* tptable, bool* mate);
 #endif
@@ -0,0 +1,109 @@
+#include "board.h"
+#include "bench.h"
+#include "aiboard4.h"
+#include "perft.h"
+#include <chrono>
+
+//开局(暗子几乎都没翻)、中局、暗子全部翻开的残局各几个; cppjieqi的bench.cpp里是同一组, 两边要一起改
+static const BenchPosition bench_positions[] = {
+    {"opening-1", "defgkgfed/9/1h5h1/i1i1i3i/6p2/B8/2I1I1I1I/1H5H1/9/DEFGKGFED w", 1},
+    {"opening-2", "defgkgfed/9/1h5h1/2i1i1i1i/r8/2A5C/I3I1I2/1H5H1/9/DEFGKGFED b", 1},
+    {"opening-3", "defgkgfed/9/7h1/2i1i1i1i/p8/4P3P/IbI3I2/1H5H1/9/DEFGKGFED w", 2},
+    {"opening-4", "defgkgfed/9/1h5h1/2i5i/b3r1b2/2P1A3R/I5I2/1H5H1/9/DEFGKGFED w", 3},
+    {"middle-1", "P1f1kgfBd/4r4/9/9/p2Ap1a1b/R1P3R1N/9/4C4/7b1/aE1GKGFED w", 10},
+    {"middle-2", "defgkg1e1/9/3rc4/1a7/6b2/A1p1N1P1c/7p1/R1B1R3P/9/D2GKG3 w", 13},
+    {"middle-3", "d3kgf2/3r3p1/2n1p4/7a1/P3b1b2/2A3R1R/9/2P1PCB2/4P4/2F1KG3 w", 16},
+    {"middle-4", "2fR1g2C/4k4/2r1nc3/7B1/8b/2p1A1R2/9/4PPC2/p3A4/3GK3D w", 20},
+    {"endgame-1", "1N2k4/P8/4p1c2/6P2/9/2p1B3c/4P1b2/1p3r1pP/4R4/4K2P1 b", 24},
+    {"endgame-2", "4k2p1/8P/7P1/3r2B2/9/9/4C4/7b1/9/r1paK4 b", 31},
+    {"endgame-3", "2P6/4k4/9/9/2a1N4/9/9/9/4P4/4K4 b", 47},
+};
+static const int bench_num = (int)(sizeof(bench_positions) / sizeof(bench_positions[0]));
+
+static int _count_covered(const char* state){
+    int covered = 0;
+    for(int i = 51; i <= 203; ++i){
+        covered += (state[i] >= 'D' && state[i] <= 'I') || (state[i] >= 'd' && state[i] <= 'i');
+    }
+    return covered;
+}
+
+//按FEN摆好board: 暗子池红黑两边看到的一样, 历史里只有这一个局面
+static bool _setup_bench_position(const BenchPosition& position, board::Board* board){
+    PerftPosition parsed;
+    if(!parsed.Parse(position.fen)){
+        printf("[FAILED 0]board --> bench.cpp --> _setup_bench_position --> %s: FEN解析不了\n", position.name);
+        return false;
+    }
+    board -> Reset(NULL);
+    memcpy(board -> state_red, parsed.state, MAX);
+    memcpy(board -> state_black, parsed.state, MAX);
+    board -> rotate(board -> state_black);
+    board -> turn = parsed.turn;
+    board -> round = position.round;
+    board -> hist.clear();
+    board -> hist[board -> state_red] = false;
+    memset(board -> di_red, 0, sizeof(board -> di_red));
+    for(int i = 0; i < VERSION_MAX; ++i){
+        for(int t = 0; t < PERFT_PIECE_TYPES; ++t){
+            board -> di_red[i][1][(int)PERFT_TYPE_CHARS[t]] = parsed.pool[1][t];
+            board -> di_red[i][0][PERFT_TYPE_CHARS[t] ^ 32] = parsed.pool[0][t];
+        }
+    }
+    memcpy(board -> di_black, board -> di_red, sizeof(board -> di_red));
+    return true;
+}
+
+const BenchPosition* GetBenchPositions(int* num){
+    *num = bench_num;
+    return bench_positions;
+}
+
+uint64_t RunBench(int depth, int rollouts){
+    tp* tptable = new (std::nothrow) tp[MAX_ZOBRIST];
+    if(!tptable){
+        printf("[FAILED 0]board --> bench.cpp --> RunBench --> tptable is NULL!\n");
+        return 0;
+    }
+    uint64_t signature = 14695981039346656037ull;
+    printf("bench: PVS depth = %d, DUCT rollouts = %d, %d个局面\n", depth, rollouts, bench_num);
+    uint64_t pvs_nodes = 0;
+    size_t pvs_us = 0;
+    std::vector<std::string> pvs_moves;
+    for(int i = 0; i < bench_num; ++i){
+        const BenchPosition& position = bench_positions[i];
+        board::Board b;
+        if(!_setup_bench_position(position, &b)){
+            delete[] tptable;
+            return 0;
+        }
+        memset((void*)tptable, 0, sizeof(tp) * MAX_ZOBRIST); //每个局面都从空的置换表开始
+        std::unordered_map<std::string, bool> hist = b.hist;
+        std::unique_ptr<board::AIBoard4> thinker(new board::AIBoard4(b.turn ? b.state_red : b.state_black, b.turn, b.round, b.turn ? b.di_red : b.di_black, 0, tptable, &hist));
+        thinker -> thinker_type = false;
+        thinker -> limits.depth = depth;
+        //搜索过程中的输出都不要
+        std::streambuf* buf = std::cout.rdbuf(NULL);
+        const auto start = std::chrono::high_resolution_clock::now();
+        const std::string move = thinker -> Think(thinker -> limits.MaxDepth());
+        const size_t us = (size_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout.rdbuf(buf);
+        signature = BenchMix(signature, thinker -> search_nodes);
+        for(const char c : move){
+            signature = BenchMix(signature, (unsigned char)c);
+        }
+        pvs_moves.push_back(move);
+        pvs_nodes += thinker -> search_nodes;
+        pvs_us += us;
+        printf("bench: PVS  %-10s 暗子%2d, nodes = %10zu, time = %8.1f ms, nps = %10.0f, move = %s\n", position.name, _count_covered(b.state_red), \
+            (size_t)thinker -> search_nodes, us / 1000.0, thinker -> search_nodes * 1e6 / (us ? us : 1), move.c_str());
+    }
+    delete[] tptable;
+    printf("bench: PVS  total nodes = %zu, time = %.1f ms, nps = %.0f\n", (size_t)pvs_nodes, pvs_us / 1000.0, pvs_nodes * 1e6 / (pvs_us ? pvs_us : 1));
+    signature = RunBenchDUCT(rollouts, signature, pvs_moves);
+    if(!signature){
+        return 0;
+    }
+    printf("bench: signature = %016llx\n", (unsigned long long)signature);
+    return signature;
+}
@@ -0,0 +1,43 @@
+#ifndef bench_h
+#define bench_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+#define BENCH_SEED 20211017u //DUCT的确定化和rollout用这个种子加局面的下标
+#define BENCH_DEFAULT_DEPTH 7 //thinker4搜到6层以内就停的话还要用calleval4把暗子展开再算一遍, 慢得多, 和平时下棋也不一样
+#define BENCH_DEFAULT_ROLLOUTS 2000
+
+//测试局面: FEN(格式和perft一样, 见perft.h), 暗子池按perft的规则从棋盘上算出来, 双方看到的一样
+//round是AIBoard的回合数(round为0时会查开局库, 小于15时搜索深度不一样), FEN里没有, 单独写
+//cppjieqi和cppjieqi2用同一组局面, PVS和DUCT都从这个FEN摆
+struct BenchPosition{
+    const char* name;
+    const char* fen;
+    int round;
+};
+
+//固定的局面集
+const BenchPosition* GetBenchPositions(int* num);
+
+//FNV-1a, 把x的8个字节混进签名
+inline uint64_t BenchMix(uint64_t signature, uint64_t x){
+    for(int k = 0; k < 8; ++k){
+        signature = (signature ^ ((x >> (8 * k)) & 0xff)) * 1099511628211ull;
+    }
+    return signature;
+}
+
+//DUCT的部分在bench_duct.cpp里: MCTSBoard.h和board.h的宏有冲突, 所以这个头文件也不include board.h, 不能放在一个文件里
+//pvs_moves[i]是PVS在第i个局面上选的着法(ucci), 比较rollout策略时当参考
+uint64_t RunBenchDUCT(int rollouts, uint64_t signature, const std::vector<std::string>& pvs_moves); //FEN解析不了返回0
+
+//PVS(AIBoard4)在每个局面上搜到固定深度, DUCT在每个局面上做固定次数的rollout
+//打印每个局面的节点数、用时、NPS(DUCT是rollout/s), 最后打印签名
+//签名只由节点数、选的着法和根节点的访问次数决定: 改了代码签名不变说明搜索树没变, 只是快慢变了
+//返回签名, FEN解析不了返回0
+uint64_t RunBench(int depth, int rollouts);
+
+#endif
@@ -0,0 +1,162 @@
+#include "bench.h"
+#include "perft.h"
+#include "ISMCTS.h"
+#include <chrono>
+#include <thread>
+#define BENCH_QUALITY_DETERMINIZATIONS 8 //和各策略分开报的大一些的搜索: 均匀随机rollout的根并行DUCT, 这么多个确定化、每个rollouts次
+
+//一种rollout策略(或者ISMCTS)在整个局面集上的速度和决策质量
+//参考是PVS在同一个FEN上搜到固定深度选的着法, 和rollout策略无关
+struct _PolicyResult{
+    const char* name;
+    board::_DUCT::PlayoutPolicy policy;
+    bool ismcts = false; //一棵信息集的树, rollouts次迭代每次一个新的确定化
+    int determinizations = 1; //根并行DUCT的确定化个数
+    size_t us = 0;
+    int agree = 0; //选的着法和PVS一样的局面数
+};
+
+//最后一个是BENCH_QUALITY_DETERMINIZATIONS个确定化的均匀随机DUCT, 单独打印
+static std::vector<_PolicyResult> _make_policies(){
+    using board::_DUCT::PlayoutPolicy;
+    std::vector<_PolicyResult> results(6);
+    results[0].name = "uniform";
+    results[1].name = "heavy";
+    results[1].policy.heavy = true;
+    results[2].name = "static";
+    results[2].policy.leaf = PlayoutPolicy::STATIC;
+    results[3].name = "quiescence";
+    results[3].policy.leaf = PlayoutPolicy::QUIESCENCE;
+    results[4].name = "ismcts";
+    results[4].ismcts = true;
+    results[5].name = "uniform-x8";
+    results[5].determinizations = BENCH_QUALITY_DETERMINIZATIONS;
+    return results;
+}
+
+//AIBoard给出的ucci("a0a1")是行棋方视角的, 换成红方视角的格子, 和DUCT的着法一样
+static board::_DUCT::Move _ucci_move(const std::string& ucci, bool turn){
+    const int from = ((12 - (ucci[1] - '0')) << 4) | (ucci[0] - 'a' + 3);
+    const int to = ((12 - (ucci[3] - '0')) << 4) | (ucci[2] - 'a' + 3);
+    board::_DUCT::Move move;
+    move.from = (unsigned char)(turn ? from : 254 - from);
+    move.to = (unsigned char)(turn ? to : 254 - to);
+    return move;
+}
+
+//每种策略用一个确定化做rollouts次rollout(ISMCTS是rollouts次迭代), 选的(访问次数最多的)着法和PVS的比
+static void _compare_policies(const MCTSSim::DeterminizedSimulator& sim, int rollouts, uint32_t seed, const board::_DUCT::Move& reference, std::vector<_PolicyResult>* results){
+    for(_PolicyResult& result : *results){
+        board::_DUCT::Move move;
+        const auto start = std::chrono::high_resolution_clock::now();
+        if(result.ismcts){
+            const uint32_t key[2] = {seed, 1};
+            board::_MCTS::Randomizer rng((const char*)key, (const char*)(key + 2));
+            MCTSSim::DeterminizedSimulator ismcts_sim(sim);
+            ismcts_sim.rng = &rng;
+            board::_DUCT::ISMCTS ismcts(&ismcts_sim);
+            ismcts.policy = result.policy;
+            ismcts.search(rollouts);
+            move = board::_DUCT::best_root_move(ismcts.root_moves);
+        }else{
+            const bool parallel = result.determinizations > 1;
+            board::_DUCT::RootParallelDUCT duct;
+            duct.policy = result.policy;
+            duct.run(sim, result.determinizations, rollouts, parallel ? std::thread::hardware_concurrency() : 1, parallel ? seed : seed + 1);
+            move = board::_DUCT::best_root_move(duct.root_moves);
+        }
+        result.us += (size_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        result.agree += move.from == reference.from && move.to == reference.to;
+    }
+}
+
+//按FEN摆好MCTSBoard(红方视角), 双方的暗子池按FEN算出来的填进BelieveState, 和PVS那边的di一样
+static bool _setup_duct_position(const BenchPosition& position, board::_MCTS::MCTSBoard* board, bool* turn){
+    PerftPosition parsed;
+    if(!parsed.Parse(position.fen)){
+        printf("[FAILED 0]board --> bench_duct.cpp --> _setup_duct_position --> %s: FEN解析不了\n", position.name);
+        return false;
+    }
+    memcpy(board -> board, parsed.state, board::_MCTS::BOARD_SIZE);
+    board::_MCTS::BelieveState* pools[2] = {&board -> oppo_covered, &board -> self_covered};
+    for(int side = 0; side < 2; ++side){
+        unsigned char* remaining = pools[side] -> remaining;
+        remaining[0] = 0;
+        for(int t = 0; t < PERFT_PIECE_TYPES; ++t){
+            for(int k = 0; k < parsed.pool[side][t]; ++k){
+                remaining[++remaining[0]] = side ? PERFT_TYPE_CHARS[t] : PERFT_TYPE_CHARS[t] ^ 32;
+            }
+        }
+    }
+    board -> bs_zobrist = board -> self_covered.zobrist() ^ board -> oppo_covered.zobrist();
+    board -> board_zobrist = board -> compute_board_zobrist();
+    *turn = parsed.turn;
+    return true;
+}
+
+static int _count_covered(const board::_MCTS::MCTSBoard& board){
+    int covered = 0;
+    for(int i = 51; i <= 203; ++i){
+        covered += board::_MCTS::is_dark(board.board[i]);
+    }
+    return covered;
+}
+
+uint64_t RunBenchDUCT(int rollouts, uint64_t signature, const std::vector<std::string>& pvs_moves){
+    int num = 0;
+    const BenchPosition* positions = GetBenchPositions(&num);
+    if((int)pvs_moves.size() != num){
+        printf("[FAILED 1]board --> bench_duct.cpp --> RunBenchDUCT --> PVS的着法有%zu个, 局面有%d个\n", pvs_moves.size(), num);
+        return 0;
+    }
+    uint64_t duct_nodes = 0;
+    size_t duct_us = 0;
+    std::vector<_PolicyResult> policies = _make_policies();
+    for(int i = 0; i < num; ++i){
+        const BenchPosition& position = positions[i];
+        board::_MCTS::MCTSBoard initial;
+        bool turn = true;
+        if(!_setup_duct_position(position, &initial, &turn)){
+            return 0;
+        }
+        //确定化和rollout全用这一个随机数, 种子只和局面的下标有关
+        const uint32_t seed = BENCH_SEED + i;
+        const char* seed_bytes = (const char*)&seed;
+        board::_MCTS::Randomizer rng(seed_bytes, seed_bytes + sizeof(seed));
+        MCTSSim::DeterminizedSimulator sim(initial, turn, &rng);
+        board::_DUCT::DUCT tree(&sim);
+        const auto start = std::chrono::high_resolution_clock::now();
+        tree.determinize(rollouts);
+        const size_t us = (size_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        signature = BenchMix(signature, tree.nallocCount());
+        for(const auto& stat : tree.root_moves){
+            signature = BenchMix(signature, stat.second.count);
+        }
+        duct_nodes += tree.nallocCount();
+        duct_us += us;
+        printf("bench: DUCT %-10s 暗子%2d, nodes = %10d, time = %8.1f ms, rollouts/s = %10.0f\n", position.name, _count_covered(initial), \
+            tree.nallocCount(), us / 1000.0, rollouts * 1e6 / (us ? us : 1));
+        const board::_DUCT::Move reference = _ucci_move(pvs_moves[i], turn);
+        bool found = false;
+        for(const auto& stat : tree.root_moves){
+            found = found || (stat.first.from == reference.from && stat.first.to == reference.to);
+        }
+        if(!found){
+            printf("[FAILED 2]board --> bench_duct.cpp --> RunBenchDUCT --> %s: PVS的着法%s不在DUCT的着法里\n", position.name, pvs_moves[i].c_str());
+            return 0;
+        }
+        _compare_policies(sim, rollouts, seed, reference, &policies); //在签名之后做, 不影响签名
+    }
+    printf("bench: DUCT total nodes = %zu, time = %.1f ms, rollouts/s = %.0f\n", (size_t)duct_nodes, duct_us / 1000.0, (double)rollouts * num * 1e6 / (duct_us ? duct_us : 1));
+    printf("bench: rollout策略, 参考是PVS在同一个局面上搜到固定深度的着法, 各策略用1个确定化 x %d次rollout, ismcts是%d次迭代\n", rollouts, rollouts);
+    for(const _PolicyResult& result : policies){
+        if(result.determinizations > 1){
+            continue;
+        }
+        printf("bench: DUCT %-10s rollouts/s = %10.0f, 和PVS一致 %d/%d\n", result.name, (double)rollouts * num * 1e6 / (result.us ? result.us : 1), result.agree, num);
+    }
+    //大一些的搜索和PVS差多少, 看上面各策略的一致数时作对照
+    const _PolicyResult& large = policies.back();
+    printf("bench: 对照: 均匀随机rollout的根并行DUCT(%d个确定化 x %d次rollout)和PVS一致 %d/%d\n", large.determinizations, rollouts, large.agree, num);
+    return signature;
+}
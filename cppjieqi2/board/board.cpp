@@ -527,6 +527,10 @@ void board::Board::Print_ij_ucci(unsigned char i, unsigned char j){
 }
 
 void board::Board::GenerateRandomMap(){
+    GenerateRandomMap(NULL);
+}
+
+void board::Board::GenerateRandomMap(std::mt19937* rng){
     auto pop_chess = [](std::vector<char>& v, char c){
         for(std::vector<char>::iterator it = v.begin(); it != v.end(); ){
             if(*it == c){
@@ -555,8 +559,13 @@ void board::Board::GenerateRandomMap(){
     std::vector<unsigned char> position_black = {TXY(9, 0), TXY(9, 1), TXY(9, 2), TXY(9, 3), TXY(9, 5), TXY(9, 6), \
         TXY(9, 7), TXY(9, 8), TXY(7, 1), TXY(7, 7), TXY(6, 0), TXY(6, 2), TXY(6, 4), TXY(6, 6), TXY(6, 8)};
     int size = 15;
-    SV(chararray_red); 
-    SV(chararray_black);
+    if(rng){
+        SV_SEEDED(chararray_red, *rng);
+        SV_SEEDED(chararray_black, *rng);
+    }else{
+        SV(chararray_red); 
+        SV(chararray_black);
+    }
     std::unordered_map<unsigned char, char> r, b;
     for(int i = 0, cnt = 0; i < size; ++i){
         if(state_red[position_red[i]] >= 'D' && state_red[position_red[i]] <= 'I'){
@@ -32,11 +32,16 @@ God::God(const char* file): ok(true), redwin(0), blackwin(0), draw(0), file(file
         return;
     }
     while(std::getline(instream, line)){
+        line = trim(line);
         if(counter >= 4){
-            ok = false;
-            break;
+            //第5行起是可选的玩家选项, 空行和#开头的行跳过
+            if(!line.empty() && line[0] != '#' && !ParseOption(line)){
+                ok = false;
+                break;
+            }
+            ++counter;
+            continue;
         }
-        line = trim(line);
 
         if(counter == 0 && !line.empty()){
             if(!isT<int>(line, &type1)){
@@ -76,6 +81,37 @@ God::God(const char* file): ok(true), redwin(0), blackwin(0), draw(0), file(file
     instream.close();
 }
 
+//player1.key=value / player2.key=value, key是depth, nodes或movetime
+bool God::ParseOption(const std::string& line){
+    const size_t dot = line.find('.');
+    const size_t eq = line.find('=');
+    if(dot == std::string::npos || eq == std::string::npos || dot > eq){
+        printf("players.conf: 无法解析的选项 %s\n", line.c_str());
+        return false;
+    }
+    const std::string player = trim(line.substr(0, dot));
+    const std::string key = trim(line.substr(dot + 1, eq - dot - 1));
+    const std::string value = trim(line.substr(eq + 1));
+    if(player != "player1" && player != "player2"){
+        printf("players.conf: 未知的玩家 %s\n", player.c_str());
+        return false;
+    }
+    board::SearchLimits& limits = player == "player1" ? limits1 : limits2;
+    bool parsed = false;
+    if(key == "depth"){
+        parsed = isT<int>(value, &limits.depth) && limits.depth >= 0;
+    }else if(key == "nodes"){
+        parsed = isT<uint64_t>(value, &limits.nodes);
+    }else if(key == "movetime"){
+        parsed = isT<size_t>(value, &limits.movetime);
+    }
+    if(!parsed){
+        printf("players.conf: 无法解析的搜索限制 %s\n", line.c_str());
+        return false;
+    }
+    return true;
+}
+
 God::~God(){
     if(tptable){
        delete[] tptable;
@@ -103,9 +139,10 @@ int God::StartThinker(std::ofstream* of){
             return BLACK_WIN;
         }
         thinker1 -> thinker_type = type1;
+        thinker1 -> limits = limits1;
         thinker1 -> retry_num = thinker1 -> thinker_type?1:5;
         for(int i = 0; i < thinker1 -> retry_num; ++i){
-            std::string think_result = thinker1 -> Think(8); // This function might cost a lot of time!
+            std::string think_result = thinker1 -> Think(limits1.MaxDepth()); // This function might cost a lot of time!
             std::string trim_think_result = trim(think_result);
             if(trim_think_result == "R" || trim_think_result == "r"){
                 return BLACK_WIN;
@@ -144,9 +181,10 @@ int God::StartThinker(std::ofstream* of){
             return RED_WIN;
         }
         thinker2 -> thinker_type = type2;
+        thinker2 -> limits = limits2;
         thinker2 -> retry_num = thinker2 -> thinker_type?1:5;
         for(int i = 0; i < thinker2 -> retry_num; ++i){
-            std::string think_result = thinker2 -> Think(8); // This function might cost a lot of time!
+            std::string think_result = thinker2 -> Think(limits2.MaxDepth()); // This function might cost a lot of time!
             std::string trim_think_result = trim(think_result);
             if(trim_think_result == "R" || trim_think_result == "r"){
                 return RED_WIN;
@@ -419,6 +457,7 @@ int God::StartGameLoopAlternatively(size_t winning_threshold){
         }
         cnt = !cnt;
         std::swap(type1, type2);
+        std::swap(limits1, limits2);
     }
     printf("握手言和!\n");
     printf("cnt = %d. Player1_win %zu : Draw %zu : Player2_win %zu\n", cnt, player1win, draw, player2win);
@@ -39,6 +39,8 @@ struct God{
     tp* tptable;
     std::string file;
     std::string logfile;
+    board::SearchLimits limits1; //玩家1的搜索限制, 跟着type1走
+    board::SearchLimits limits2; //玩家2的搜索限制, 跟着type2走
     std::vector<std::tuple<char, int, int, char>> red_eat_black;
     std::vector<std::tuple<char, int, int, char>> black_eat_red;
     std::unordered_set<std::string> hist_cache;
@@ -58,6 +60,7 @@ struct God{
     int StartGameLoopAlternatively(size_t winning_threshold);//红黑交替
     int StartGameLoopAlternatively();//红黑交替
     std::string PrintEat(bool turn, bool SHOWDARK);
+    bool ParseOption(const std::string& line);
 
     std::function<std::string(const char)> getstring = [](const char c) -> std::string {
         std::string ret;
@@ -0,0 +1,499 @@
+#include "board.h"
+#include "perft.h"
+#include "aiboard4.h"
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+static_assert(MAX == PERFT_STATE_SIZE && MAX_POSSIBLE_MOVES == PERFT_MAX_MOVES, "perft.h和board.h的大小要一样");
+
+static const char perft_types[] = PERFT_TYPE_CHARS; //暗子DEFGHI翻开以后的子
+static const int perft_army[PERFT_PIECE_TYPES] = {2, 2, 2, 2, 2, 5};
+static const char* const perft_generator_names[] = {"referee", "ai4", "mcts"}; //第一个是裁判, 对拍时用它展开
+#define PERFT_GENERATORS ((int)(sizeof(perft_generator_names) / sizeof(perft_generator_names[0])))
+
+//开局, 再加上cppjieqi的bench局面集里的几个局面(和cppjieqi里是同一组, 两边的数可以对照)
+static const char* const perft_suite[][2] = {
+    {"start", "defgkgfed/9/1h5h1/i1i1i1i1i/9/9/I1I1I1I1I/1H5H1/9/DEFGKGFED w"},
+    {"opening-2", "defgkgfed/9/1h5h1/2i1i1i1i/r8/2A5C/I3I1I2/1H5H1/9/DEFGKGFED b"},
+    {"opening-4", "defgkgfed/9/1h5h1/2i5i/b3r1b2/2P1A3R/I5I2/1H5H1/9/DEFGKGFED w"},
+    {"middle-1", "P1f1kgfBd/4r4/9/9/p2Ap1a1b/R1P3R1N/9/4C4/7b1/aE1GKGFED w"},
+    {"middle-2", "defgkg1e1/9/3rc4/1a7/6b2/A1p1N1P1c/7p1/R1B1R3P/9/D2GKG3 w"},
+    {"endgame-1", "1N2k4/P8/4p1c2/6P2/9/2p1B3c/4P1b2/1p3r1pP/4R4/4K2P1 b"},
+};
+
+static int _type_index(char c){
+    const char* p = strchr(perft_types, toupper(c));
+    return c && p ? (int)(p - perft_types) : -1;
+}
+
+static bool _is_dark(char c){
+    return (c >= 'D' && c <= 'I') || (c >= 'd' && c <= 'i');
+}
+
+static char _swapcase(char c){
+    return isalpha(c) ? c ^ 32 : c;
+}
+
+static void _rotate(const char state_red[MAX], char state_black[MAX]){
+    memcpy(state_black, state_red, MAX);
+    std::reverse(state_black, state_black + 255);
+    std::transform(state_black, state_black + 255, state_black, _swapcase);
+}
+
+static std::string _fen(const char state[MAX], bool turn){
+    std::string fen;
+    for(int row = 3; row <= 12; ++row){
+        int empty = 0;
+        for(int col = 3; col <= 11; ++col){
+            const char c = state[row * 16 + col];
+            if(c == '.'){
+                ++empty;
+                continue;
+            }
+            if(empty){
+                fen += (char)('0' + empty);
+                empty = 0;
+            }
+            fen += c;
+        }
+        if(empty){
+            fen += (char)('0' + empty);
+        }
+        fen += row < 12 ? '/' : ' ';
+    }
+    fen += turn ? 'w' : 'b';
+    return fen;
+}
+
+bool PerftPosition::Parse(const std::string& fen){
+    static PerftPosition start;
+    static const bool start_ok = [](){
+        //暗子只能在初始位置上, 用开局的局面查
+        memset(start.state, 0, sizeof(start.state));
+        memset(start.state, ' ', CHESS_BOARD_SIZE);
+        const char* p = perft_suite[0][1];
+        for(int row = 3, col = 3; *p != ' '; ++p){
+            if(*p == '/'){
+                ++row, col = 3;
+            }else if(isdigit(*p)){
+                for(int k = 0; k < *p - '0'; ++k){
+                    start.state[row * 16 + col++] = '.';
+                }
+            }else{
+                start.state[row * 16 + col++] = *p;
+            }
+        }
+        return true;
+    }();
+    (void)start_ok;
+    memset(state, 0, sizeof(state));
+    memset(state, ' ', CHESS_BOARD_SIZE);
+    size_t k = 0;
+    for(int row = 3; row <= 12; ++row){
+        int col = 3;
+        for(; k < fen.size() && fen[k] != '/' && fen[k] != ' '; ++k){
+            const char c = fen[k];
+            const int n = isdigit(c) ? c - '0' : 1;
+            if(col + n > 12 || (!isdigit(c) && !strchr("RNBAKCPDEFGHIrnbakcpdefghi", c))){
+                printf("[FAILED 1]board --> perft.cpp --> PerftPosition::Parse --> %s: 第%d行不对\n", fen.c_str(), 12 - row);
+                return false;
+            }
+            for(int m = 0; m < n; ++m){
+                state[row * 16 + col++] = isdigit(c) ? '.' : c;
+            }
+        }
+        const bool last = row == 12;
+        if(col != 12 || k >= fen.size() || fen[k] != (last ? ' ' : '/')){
+            printf("[FAILED 1]board --> perft.cpp --> PerftPosition::Parse --> %s: 第%d行不是9列\n", fen.c_str(), 12 - row);
+            return false;
+        }
+        ++k;
+    }
+    if(k >= fen.size() || (fen[k] != 'w' && fen[k] != 'b')){
+        printf("[FAILED 2]board --> perft.cpp --> PerftPosition::Parse --> %s: 没有写谁走\n", fen.c_str());
+        return false;
+    }
+    turn = fen[k] == 'w';
+    int covered[2] = {0, 0}, kings[2] = {0, 0};
+    for(int side = 0; side < 2; ++side){
+        std::copy(perft_army, perft_army + PERFT_PIECE_TYPES, pool[side]);
+    }
+    for(int i = 51; i <= 203; ++i){
+        const char c = state[i];
+        if(c == ' ' || c == '.'){
+            continue;
+        }
+        const bool side = isupper(c);
+        if(_is_dark(c)){
+            if(c != start.state[i]){
+                printf("[FAILED 3]board --> perft.cpp --> PerftPosition::Parse --> %s: 暗子%c不在初始位置上\n", fen.c_str(), c);
+                return false;
+            }
+            ++covered[side];
+        }else if(toupper(c) == 'K'){
+            ++kings[side];
+        }else{
+            pool[side][_type_index(c)] = std::max(0, pool[side][_type_index(c)] - 1);
+        }
+    }
+    for(int side = 0; side < 2; ++side){
+        int remain = 0;
+        for(int t = 0; t < PERFT_PIECE_TYPES; ++t){
+            remain += pool[side][t];
+        }
+        if(kings[side] != 1 || remain < covered[side]){
+            printf("[FAILED 4]board --> perft.cpp --> PerftPosition::Parse --> %s: %s方要有一个将, 暗子不能比没翻开的子多\n", fen.c_str(), side ? "红" : "黑");
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string PerftPosition::Fen() const{
+    return _fen(state, turn);
+}
+
+//裁判: 自己维护state_red/state_black, 每个节点调一次Board::GenMovesWithScore再扫一遍_is_legal_move
+class RefereeGenerator: public PerftGenerator{
+public:
+    const char* Name() const override{
+        return perft_generator_names[0];
+    }
+    void Setup(const PerftPosition& position) override{
+        memcpy(_board -> state_red, position.state, MAX);
+        _rotate(_board -> state_red, _board -> state_black);
+        _board -> turn = position.turn;
+        _stack.clear();
+    }
+    int Generate(PerftMove moves[MAX_POSSIBLE_MOVES], bool* mate) override{
+        const bool turn = _board -> turn;
+        const char* state = turn ? _board -> state_red : _board -> state_black;
+        _board -> GenMovesWithScore();
+        int n = 0;
+        *mate = false;
+        for(unsigned char i = 51; i <= 203; ++i){
+            if(!isupper(state[i])){
+                continue;
+            }
+            for(unsigned char j = 51; j <= 203 && n < MAX_POSSIBLE_MOVES; ++j){
+                if(_board -> IsLegalMove(i, j)){
+                    *mate |= state[j] == 'k';
+                    moves[n++] = PerftMove{(unsigned char)(turn ? i : 254 - i), (unsigned char)(turn ? j : 254 - j), 0};
+                }
+            }
+        }
+        return n;
+    }
+    void Make(const PerftMove& move) override{
+        char* red = _board -> state_red;
+        char* black = _board -> state_black;
+        _stack.push_back({move.src, move.dst, red[move.src], red[move.dst]});
+        red[move.dst] = move.reveal ? (_board -> turn ? move.reveal : (char)tolower(move.reveal)) : red[move.src];
+        red[move.src] = '.';
+        black[254 - move.dst] = _swapcase(red[move.dst]);
+        black[254 - move.src] = '.';
+        _board -> turn = !_board -> turn;
+    }
+    void Unmake() override{
+        const std::tuple<unsigned char, unsigned char, char, char> last = _stack.back();
+        _stack.pop_back();
+        const unsigned char src = std::get<0>(last), dst = std::get<1>(last);
+        char* red = _board -> state_red;
+        char* black = _board -> state_black;
+        red[src] = std::get<2>(last);
+        red[dst] = std::get<3>(last);
+        black[254 - src] = _swapcase(red[src]);
+        black[254 - dst] = _swapcase(red[dst]);
+        _board -> turn = !_board -> turn;
+    }
+private:
+    std::unique_ptr<board::Board> _board = std::unique_ptr<board::Board>(new board::Board());
+    std::vector<std::tuple<unsigned char, unsigned char, char, char>> _stack; //src, dst, 走之前src和dst上的子(红方视角)
+};
+
+//AIBoard4::GenMovesWithScore<false>: 用引擎自己的Move/UndoMove, 找到吃将就不往下生成了
+//Move以后翻开的暗子是U/u, 换成翻开的子; UndoMove之前再换回U/u, 它靠U认出这步走的是暗子
+class AI4Generator: public PerftGenerator{
+public:
+    const char* Name() const override{
+        return perft_generator_names[1];
+    }
+    void Setup(const PerftPosition& position) override{
+        unsigned char di[VERSION_MAX][2][123];
+        memset(di, 0, sizeof(di));
+        char state[MAX];
+        if(position.turn){
+            memcpy(state, position.state, MAX);
+        }else{
+            _rotate(position.state, state);
+        }
+        _hist.clear();
+        _ai.reset(new board::AIBoard4(state, position.turn, 1, di, 0, NULL, &_hist)); //只走子不搜索, 用不到置换表
+        _reveals.clear();
+    }
+    int Generate(PerftMove moves[MAX_POSSIBLE_MOVES], bool* mate) override{
+        scoretuple legal_moves[MAX_POSSIBLE_MOVES];
+        int num_of_legal_moves = 0;
+        short killer_score = 0;
+        unsigned char mate_src = 0, mate_dst = 0;
+        bool killer_is_alive = false;
+        *mate = _ai -> GenMovesWithScore<false>(legal_moves, num_of_legal_moves, NULL, killer_score, mate_src, mate_dst, killer_is_alive);
+        const bool turn = _ai -> turn;
+        for(int i = 0; i < num_of_legal_moves; ++i){
+            const unsigned char src = SRC(legal_moves[i]), dst = DST(legal_moves[i]);
+            moves[i] = PerftMove{(unsigned char)(turn ? src : 254 - src), (unsigned char)(turn ? dst : 254 - dst), 0};
+        }
+        return num_of_legal_moves;
+    }
+    void Make(const PerftMove& move) override{
+        const bool turn = _ai -> turn;
+        const unsigned char dst = turn ? move.dst : 254 - move.dst;
+        _ai -> Move(turn ? move.src : 254 - move.src, dst, 0);
+        if(move.reveal){
+            (turn ? _ai -> state_red : _ai -> state_black)[dst] = move.reveal;
+            (turn ? _ai -> state_black : _ai -> state_red)[254 - dst] = (char)tolower(move.reveal);
+        }
+        _reveals.push_back(move.reveal ? dst : 0);
+    }
+    void Unmake() override{
+        const unsigned char dst = _reveals.back();
+        _reveals.pop_back();
+        if(dst){
+            //现在轮到对方走, 刚才的行棋方是!turn
+            (_ai -> turn ? _ai -> state_black : _ai -> state_red)[dst] = 'U';
+            (_ai -> turn ? _ai -> state_red : _ai -> state_black)[254 - dst] = 'u';
+        }
+        _ai -> UndoMove(1);
+    }
+private:
+    std::unordered_map<std::string, bool> _hist;
+    std::unique_ptr<board::AIBoard4> _ai;
+    std::vector<unsigned char> _reveals; //每步翻开的暗子在行棋方视角的位置, 没翻开为0
+};
+
+static std::unique_ptr<PerftGenerator> _make_generator(int index){
+    if(index == 0){
+        return std::unique_ptr<PerftGenerator>(new RefereeGenerator());
+    }else if(index == 1){
+        return std::unique_ptr<PerftGenerator>(new AI4Generator());
+    }
+    return MakeMCTSGenerator();
+}
+
+//对拍的计数, 所有线程共用
+struct PerftCheck{
+    std::atomic<uint64_t> nodes{0}; //对拍过的节点数
+    std::atomic<uint64_t> mismatches{0};
+};
+
+//一个线程的遍历: 自己维护红方视角的局面和双方暗子的池子, 用generators[0]展开
+//check不为NULL时每个内部节点还要让其他生成器生成一遍, 和generators[0]比
+class PerftWalker{
+public:
+    PerftWalker(const PerftPosition& position, const std::vector<int>& generators, PerftCheck* check): _position(position), _check(check){
+        for(const int index : generators){
+            _generators.push_back(_make_generator(index));
+            _generators.back() -> Setup(position);
+        }
+    }
+    int Expand(PerftMove children[PERFT_MAX_CHILDREN]){ //能吃将的局面不展开, 返回0
+        PerftMove moves[MAX_POSSIBLE_MOVES];
+        bool mate = false;
+        const int n = _generators[0] -> Generate(moves, &mate);
+        if(_check){
+            Compare(moves, n, mate);
+        }
+        if(mate){
+            return 0;
+        }
+        int num = 0;
+        const int* pool = _position.pool[_position.turn];
+        for(int i = 0; i < n; ++i){
+            if(!_is_dark(_position.state[moves[i].src])){
+                children[num++] = moves[i];
+                continue;
+            }
+            for(int t = 0; t < PERFT_PIECE_TYPES; ++t){
+                if(pool[t] > 0){
+                    children[num++] = PerftMove{moves[i].src, moves[i].dst, perft_types[t]};
+                }
+            }
+        }
+        return num;
+    }
+    void Make(const PerftMove& move){
+        char* state = _position.state;
+        _stack.push_back({move.src, move.dst, state[move.src], state[move.dst]});
+        if(move.reveal){
+            --_position.pool[_position.turn][_type_index(move.reveal)];
+            state[move.dst] = _position.turn ? move.reveal : (char)tolower(move.reveal);
+        }else{
+            state[move.dst] = state[move.src];
+        }
+        state[move.src] = '.';
+        _position.turn = !_position.turn;
+        for(std::unique_ptr<PerftGenerator>& g : _generators){
+            g -> Make(move);
+        }
+    }
+    void Unmake(){
+        const std::tuple<unsigned char, unsigned char, char, char> last = _stack.back();
+        _stack.pop_back();
+        _position.turn = !_position.turn;
+        char* state = _position.state;
+        const char moved = state[std::get<1>(last)];
+        if(_is_dark(std::get<2>(last))){
+            ++_position.pool[_position.turn][_type_index(moved)];
+        }
+        state[std::get<0>(last)] = std::get<2>(last);
+        state[std::get<1>(last)] = std::get<3>(last);
+        for(std::unique_ptr<PerftGenerator>& g : _generators){
+            g -> Unmake();
+        }
+    }
+    uint64_t Perft(int depth){
+        PerftMove children[PERFT_MAX_CHILDREN];
+        const int n = Expand(children);
+        if(depth <= 1){
+            return n;
+        }
+        uint64_t leaves = 0;
+        for(int i = 0; i < n; ++i){
+            Make(children[i]);
+            leaves += Perft(depth - 1);
+            Unmake();
+        }
+        return leaves;
+    }
+private:
+    void Compare(const PerftMove moves[], int n, bool mate){
+        std::vector<uint16_t> expect(n);
+        for(int i = 0; i < n; ++i){
+            expect[i] = moves[i].src << 8 | moves[i].dst;
+        }
+        std::sort(expect.begin(), expect.end());
+        _check -> nodes.fetch_add(1);
+        for(size_t g = 1; g < _generators.size(); ++g){
+            PerftMove other[MAX_POSSIBLE_MOVES];
+            bool other_mate = false;
+            const int m = _generators[g] -> Generate(other, &other_mate);
+            std::vector<uint16_t> got(m);
+            for(int i = 0; i < m; ++i){
+                got[i] = other[i].src << 8 | other[i].dst;
+            }
+            std::sort(got.begin(), got.end());
+            if(other_mate == mate && (mate || got == expect)){
+                continue;
+            }
+            if(_check -> mismatches.fetch_add(1) >= PERFT_MAX_REPORT){
+                continue;
+            }
+            std::vector<uint16_t> missing, extra;
+            std::set_difference(expect.begin(), expect.end(), got.begin(), got.end(), std::back_inserter(missing));
+            std::set_difference(got.begin(), got.end(), expect.begin(), expect.end(), std::back_inserter(extra));
+            std::string line = "perft: " + std::string(_generators[g] -> Name()) + "和" + _generators[0] -> Name() + "不一致: " + _position.Fen();
+            if(other_mate != mate){
+                printf("%s, %s能吃将\n", line.c_str(), mate ? _generators[0] -> Name() : _generators[g] -> Name());
+                continue;
+            }
+            line += ", 少了";
+            for(const std::vector<uint16_t>* list : {&missing, &extra}){
+                for(const uint16_t move : *list){
+                    char ucci[5];
+                    board::Board::Translate(move >> 8, move & 0xff, ucci);
+                    line += " " + std::string(ucci);
+                }
+                line += list == &missing ? ", 多了" : "\n";
+            }
+            printf("%s", line.c_str());
+        }
+    }
+    PerftPosition _position;
+    PerftCheck* _check;
+    std::vector<std::unique_ptr<PerftGenerator>> _generators;
+    std::vector<std::tuple<unsigned char, unsigned char, char, char>> _stack; //src, dst, 走之前src和dst上的子
+};
+
+//根节点的子节点用原子计数器分给各个线程, 每个线程一个PerftWalker(在主线程里构造)
+static uint64_t _perft(const PerftPosition& position, int depth, int threads, const std::vector<int>& generators, PerftCheck* check){
+    PerftWalker root(position, generators, check);
+    PerftMove children[PERFT_MAX_CHILDREN];
+    const int n = root.Expand(children);
+    if(depth <= 1){
+        return n;
+    }
+    threads = std::max(1, std::min(threads, n));
+    std::vector<std::unique_ptr<PerftWalker>> walkers;
+    for(int t = 0; t < threads; ++t){
+        walkers.emplace_back(new PerftWalker(position, generators, check));
+    }
+    std::atomic<int> next{0};
+    std::vector<uint64_t> leaves(threads, 0);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; ++t){
+        workers.emplace_back([&, t](){
+            for(int i = next.fetch_add(1); i < n; i = next.fetch_add(1)){
+                walkers[t] -> Make(children[i]);
+                leaves[t] += walkers[t] -> Perft(depth - 1);
+                walkers[t] -> Unmake();
+            }
+        });
+    }
+    uint64_t sum = 0;
+    for(int t = 0; t < threads; ++t){
+        workers[t].join();
+        sum += leaves[t];
+    }
+    return sum;
+}
+
+int RunPerft(int depth, int threads, const std::vector<std::string>& fens){
+    depth = std::max(1, depth);
+    if(threads < 1){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<PerftPosition> positions;
+    for(size_t i = 0; i < (fens.empty() ? sizeof(perft_suite) / sizeof(perft_suite[0]) : fens.size()); ++i){
+        PerftPosition position;
+        if(!position.Parse(fens.empty() ? perft_suite[i][1] : fens[i])){
+            return 1;
+        }
+        position.name = fens.empty() ? perft_suite[i][0] : "fen-" + std::to_string(i + 1);
+        positions.push_back(position);
+    }
+    uint64_t signature = 14695981039346656037ull; //FNV-1a, 只由各个局面的叶子数决定
+    auto mix = [&signature](uint64_t x){
+        for(int k = 0; k < 8; ++k){
+            signature = (signature ^ ((x >> (8 * k)) & 0xff)) * 1099511628211ull;
+        }
+    };
+    uint64_t differ = 0, mismatches = 0;
+    printf("perft: depth = %d, threads = %d, %zu个局面\n", depth, threads, positions.size());
+    for(const PerftPosition& position : positions){
+        printf("perft: %s %s\n", position.name.c_str(), position.Fen().c_str());
+        uint64_t expect = 0;
+        for(int g = 0; g < PERFT_GENERATORS; ++g){
+            const auto start = std::chrono::high_resolution_clock::now();
+            const uint64_t leaves = _perft(position, depth, threads, {g}, NULL);
+            const size_t us = (size_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+            if(g == 0){
+                expect = leaves;
+                mix(leaves);
+            }
+            differ += leaves != expect;
+            printf("perft:   %-8s leaves = %12zu, time = %9.1f ms, leaves/s = %12.0f%s\n", perft_generator_names[g], (size_t)leaves, us / 1000.0, leaves * 1e6 / (us ? us : 1), leaves == expect ? "" : " 和referee不一致!");
+        }
+        std::vector<int> all;
+        for(int g = 0; g < PERFT_GENERATORS; ++g){
+            all.push_back(g);
+        }
+        PerftCheck check;
+        _perft(position, depth, threads, all, &check);
+        printf("perft:   check    nodes = %12zu, mismatches = %zu\n", (size_t)check.nodes.load(), (size_t)check.mismatches.load());
+        mismatches += check.mismatches.load();
+    }
+    printf("perft: signature = %016llx, 叶子数不一致%zu次, 对拍不一致%zu次\n", (unsigned long long)signature, (size_t)differ, (size_t)mismatches);
+    return differ || mismatches ? 1 : 0;
+}
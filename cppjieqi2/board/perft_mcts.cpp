@@ -0,0 +1,63 @@
+#include "perft.h"
+#include "MCTSBoard.h"
+
+using board::_MCTS::MCTSBoard;
+
+//MCTSBoard::generate_valid_moves, 和MCTS的模拟器用的是同一个走法生成
+//MCTSBoard里大写是自己, 所以放两块棋盘: _red是红方视角, _black是黑方视角(旋转180度再换大小写), 走子时两块一起走
+//翻开的暗子直接用set_piece摆上去, 不动BelieveState(生成着法用不到)
+class MCTSGenerator: public PerftGenerator{
+public:
+    const char* Name() const override{
+        return "mcts";
+    }
+    void Setup(const PerftPosition& position) override{
+        memcpy(_red.board, position.state, board::_MCTS::BOARD_SIZE);
+        for(int i = 0; i < 255; ++i){
+            _black.board[254 - i] = board::_MCTS::make_turn(_red.board[i]);
+        }
+        _black.board[255] = ' ';
+        _red.board_zobrist = _red.compute_board_zobrist_const();
+        _black.board_zobrist = _black.compute_board_zobrist_const();
+        _turn = position.turn;
+        _stack.clear();
+    }
+    int Generate(PerftMove moves[PERFT_MAX_MOVES], bool* mate) override{
+        MCTSBoard& b = _turn ? _red : _black;
+        const int n = b.generate_valid_moves();
+        *mate = b.mate;
+        for(int i = 0; i < n; ++i){
+            const unsigned char from = b.moves[i].from, to = b.moves[i].to;
+            moves[i] = PerftMove{(unsigned char)(_turn ? from : 254 - from), (unsigned char)(_turn ? to : 254 - to), 0};
+        }
+        return n;
+    }
+    void Make(const PerftMove& move) override{
+        _stack.push_back({move.src, move.dst, _red.move(move.src, move.dst), _black.move(254 - move.src, 254 - move.dst)});
+        if(move.reveal){
+            const unsigned char self = move.reveal, oppo = board::_MCTS::make_turn(self);
+            _red.set_piece(move.dst, _turn ? self : oppo);
+            _black.set_piece(254 - move.dst, _turn ? oppo : self);
+        }
+        _turn = !_turn;
+    }
+    void Unmake() override{
+        const Undo& last = _stack.back();
+        _red.undo_move(last.dst, last.src, last.red);
+        _black.undo_move(254 - last.dst, 254 - last.src, last.black);
+        _stack.pop_back();
+        _turn = !_turn;
+    }
+private:
+    struct Undo{
+        unsigned char src, dst;
+        MCTSBoard::Move_Result red, black;
+    };
+    MCTSBoard _red, _black;
+    bool _turn = true;
+    std::vector<Undo> _stack;
+};
+
+std::unique_ptr<PerftGenerator> MakeMCTSGenerator(){
+    return std::unique_ptr<PerftGenerator>(new MCTSGenerator());
+}
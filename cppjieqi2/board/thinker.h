@@ -4,11 +4,34 @@
 #include "../global/global.h"
 #include "../score/score.h"
 
+#define SEARCH_DEFAULT_DEPTH 8 //没设depth时Think的最大深度
+#define SEARCH_MAX_DEPTH 20 //设了nodes或movetime而没设depth时, 迭代加深最多到这一层
+
 namespace board{
+    //players.conf第5行起的player1.depth=8, player1.nodes=2000000, player1.movetime=5000(毫秒), 0表示不限
+    //depth和nodes只看搜索本身, 和机器快慢、负载无关; 都在迭代加深的两层之间检查, 一层搜完才停
+    struct SearchLimits{
+        int depth = 0;
+        uint64_t nodes = 0;
+        size_t movetime = 0;
+        int MaxDepth() const{
+            return depth > 0 ? depth : ((nodes || movetime) ? SEARCH_MAX_DEPTH : SEARCH_DEFAULT_DEPTH);
+        }
+        //第done层搜完以后要不要停
+        bool Stop(int done, int max_depth, uint64_t searched, size_t ms) const{
+            if(done >= max_depth || (nodes && searched >= nodes)){
+                return true;
+            }
+            return movetime && 2 * ms >= movetime; //下一层一般比前面几层加起来还慢, 用掉一半就不再加深
+        }
+    };
+
     struct Thinker{
         bool thinker_type; //true: Human, false: AI
         int retry_num;
         bool turn;
+        SearchLimits limits; //God在Think之前设好
+        uint64_t search_nodes = 0; //最近一次Think搜过的节点数
         virtual std::string Think(int maxdepth) = 0;
     };
 }
@@ -5,18 +5,29 @@
 #include "global/global.h"
 #include "board/god.h"
 #include "score/score.h"
+#include "board/bench.h"
+#include "board/perft.h"
 
-extern bool read_score_table(const char* score_file, short pst[][256]);
-extern void copy_pst(short dst[][256], short src[][256]);
+extern bool read_score_table(const char* score_file, short pst[][SQUARE_SLOTS]);
 extern void IntializeL1();
-extern short pstglobal[5][123][256];
-extern unsigned char L1[256][256];
+extern void IntializeZobrist();
+extern short pstglobal[5][PIECE_SLOTS][SQUARE_SLOTS];
+extern unsigned char L1[SQUARE_SLOTS][SQUARE_SLOTS];
 
-int main(void) {
+int main(int argc, char* argv[]) {
     srand(time(NULL));
     IntializeL1();
+    IntializeZobrist();
     memset(pstglobal, 0, sizeof(pstglobal));
     assert(read_score_table("../score.conf", pstglobal[3]));
+    if(argc > 1 && strcmp(argv[1], "bench") == 0){
+        //./cppjieqi bench [depth] [rollouts]: PVS搜到固定深度, DUCT做固定次数的rollout, 看节点数、速度和签名
+        return RunBench(argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_DEPTH, argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_ROLLOUTS) ? 0 : 1;
+    }
+    if(argc > 1 && strcmp(argv[1], "perft") == 0){
+        //./cppjieqi perft [depth] [threads] [fen...]: 带暗子的perft, 裁判、AI4和MCTSBoard的走法生成逐个着法对拍
+        return RunPerft(argc > 2 ? atoi(argv[2]) : PERFT_DEFAULT_DEPTH, argc > 3 ? atoi(argv[3]) : 0, std::vector<std::string>(argv + std::min(argc, 4), argv + argc));
+    }
     God g("../players.conf");
     DEBUG ? g.StartGame() : g.StartGameLoopAlternatively();
     #if !DEBUG
@@ -1,12 +1,13 @@
 #include "score.h"
-short pstglobal[5][123][256];
-unsigned char L1[256][256]; //L1 distance between chesses
+short pstglobal[5][PIECE_SLOTS][SQUARE_SLOTS]; //所有AIBoard共享, 只读
+unsigned char L1[SQUARE_SLOTS][SQUARE_SLOTS]; //L1 distance between chesses
+uint64_t zobrist_table[SYMBOL_NUM][SQUARE_SLOTS]; //所有AIBoard共享, 置换表跨步才有意义
 
-bool read_score_table(const char* score_file, short pst[123][256]){
+bool read_score_table(const char* score_file, short pst[][SQUARE_SLOTS]){
     std::unordered_map<char, bool> is_read;
     is_read['R'] = is_read['N'] = is_read['B'] = is_read['A'] = is_read['K'] = is_read['C'] = is_read['P'] = false;
 
-    memset(pst, 0, 123 * 256);
+    memset(pst, 0, sizeof(short) * PIECE_SLOTS * SQUARE_SLOTS);
     std::ifstream instream(score_file);
     std::string line = "";
     constexpr int M = 10;
@@ -48,7 +49,7 @@ bool read_score_table(const char* score_file, short pst[123][256]){
             int counter = 0;
             int tmpint = 0;
             while(ss >> tmpint){
-                pst[(int)key][ENCODE(state_machine, counter)] = tmpint;
+                pst[PID(key)][SQ(ENCODE(state_machine, counter))] = tmpint;
                 ++counter;
                 if(counter > N){
                     break;
@@ -73,19 +74,19 @@ bool read_score_table(const char* score_file, short pst[123][256]){
     //FIX BUG: AVERAGE VALUE IS NOT CALCULATED!
     for(char c:MINGZI){
         int sum = 0;
-        for(int i = 51; i <= 203; ++i){
-            if((i & 15) < 3 || (i & 15) > 11) { continue; }
-            sum += pst[(int)c][i];
+        for(int s = 0; s < SQUARE_NUM; ++s){
+            sum += pst[PID(c)][s];
         }
-        pst[(int)c][0] = sum / 90;
+        pst[PID(c)][AVERAGE_SLOT] = sum / SQUARE_NUM;
     }
-    return true;
-}
-
-void copy_pst(short dst[][256], short src[][256]){
+    //黑方的表是红方表的镜像(mailbox 254 - i 对应紧凑下标 89 - s)
     for(char c:MINGZI){
-        memcpy(dst[(int)c], src[(int)c], 256*sizeof(short));
+        for(int s = 0; s < SQUARE_NUM; ++s){
+            pst[PID(c ^ 32)][s] = pst[PID(c)][SQUARE_NUM - 1 - s];
+        }
+        pst[PID(c ^ 32)][AVERAGE_SLOT] = pst[PID(c)][AVERAGE_SLOT];
     }
+    return true;
 }
 
 bool read_kaijuku(const char* kaijuku_file, std::unordered_map<std::string, std::pair<unsigned char, unsigned char>>& kaijuku){
@@ -138,13 +139,27 @@ bool read_kaijuku(const char* kaijuku_file, std::unordered_map<std::string, std:
 }
 
 void IntializeL1(){
-    for(int i = 0; i < 256; ++i){
-        for(int j = 0; j < 256; ++j){
-            int x1 = i >> 4;
-            int x2 = j >> 4;
-            int y1 = i & 15;
-            int y2 = j & 15;
+    memset(L1, 0, sizeof(L1));
+    for(int i = 0; i < SQUARE_NUM; ++i){
+        for(int j = 0; j < SQUARE_NUM; ++j){
+            int x1 = i / 9;
+            int x2 = j / 9;
+            int y1 = i % 9;
+            int y2 = j % 9;
             L1[i][j] = (unsigned char)(abs(x2 - x1) + abs(y2 - y1));
         }
     }
 }
+
+#define ZOBRIST_SEED 0x4a51u
+
+void IntializeZobrist(){
+    //固定种子: 每次运行同一个局面的hash都一样, 置换表里的碰撞也一样, 定深、定节点的搜索才能复现
+    std::mt19937_64 gen(ZOBRIST_SEED);
+    for(int i = 0; i < SYMBOL_NUM; ++i){
+        for(int j = 0; j < SQUARE_SLOTS; ++j){
+            //'.'和棋盘外的格子不参与hash
+            zobrist_table[i][j] = (i == SID('.') || j == SQUARE_NUM) ? 0 : gen();
+        }
+    }
+}
\ No newline at end of file
@@ -2,12 +2,108 @@
 // Created by zball on 2025/4/21.
 //
 
-#include "board/DUCT.h"
+#include "board/ISMCTS.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
-int main(){
+// ./test_uct [determinizations] [rollouts] [threads] [root|tree|ismcts] [uniform|heavy|static|quiescence] [truncate]: 初始局面上并行地跑DUCT, 每个确定化rollouts次rollout, 打印合并后的根统计
+// root: 每个线程领不同的确定化, 各建各的树; tree: 一个确定化一棵树, 所有线程在这棵树上一起走
+// ismcts: 单线程, 一棵信息集的树做determinizations * rollouts次迭代, 每次迭代一个新的确定化
+// reuse: ismcts自己和自己下determinizations步, 每步rollouts次迭代, 走访问最多的着法, 走完用advance留下子树
+//        打印每步开始时根上已有的迭代数(warm)、走的着法的访问次数(visits)和留下的子树根上的迭代数(kept)
+// uniform: rollout均匀随机走; heavy: 按吃子价值和将军做softmax; static/quiescence: 均匀随机走truncate步(默认0)以后用静态分/吃子搜索打分
+// 见board::_DUCT::PlayoutPolicy
+int main(int argc, char* argv[]){
+    const int determinizations = argc > 1 ? atoi(argv[1]) : 16;
+    const int rollouts = argc > 2 ? atoi(argv[2]) : 1000;
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+    if(threads < 1) threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* engine = argc > 4 ? argv[4] : "root";
+    board::_DUCT::PlayoutPolicy policy;
+    const char* mode = argc > 5 ? argv[5] : "uniform";
+    policy.heavy = strcmp(mode, "heavy") == 0;
+    if(strcmp(mode, "static") == 0) policy.leaf = board::_DUCT::PlayoutPolicy::STATIC;
+    if(strcmp(mode, "quiescence") == 0) policy.leaf = board::_DUCT::PlayoutPolicy::QUIESCENCE;
+    policy.truncate = argc > 6 ? atoi(argv[6]) : 0;
+    if(policy.leaf != board::_DUCT::PlayoutPolicy::PLAYOUT && !read_score_table("../score.conf", pstglobal[3])){
+        return 1;
+    }
     board::_MCTS::MCTSBoard board;
     MCTSSim::DeterminizedSimulator sim(board, true);
-    board::_DUCT::DUCT tree(&sim);
-    tree.determinize(1000);
+    auto ucci = [](int pos) -> std::string {
+        return std::string{char('a' + (pos & 15) - 3), char('0' + 12 - (pos >> 4))};
+    };
+    if(strcmp(engine, "reuse") == 0){
+        // truth是这盘棋真正的暗子摆法, 搜索只用game: game只知道走过的着法和翻出来、吃掉的子
+        const uint32_t seed = 20250420u, truth_seed = 20250421u;
+        board::_MCTS::Randomizer rng((const char*)&seed, (const char*)(&seed + 1));
+        board::_MCTS::Randomizer truth_rng((const char*)&truth_seed, (const char*)(&truth_seed + 1));
+        MCTSSim::DeterminizedSimulator truth(sim), game(sim);
+        truth.rng = &truth_rng;
+        truth.determinize();
+        game.rng = &rng;
+        board::_DUCT::ISMCTS duct(&game);
+        duct.policy = policy;
+        const auto reuse_start = std::chrono::high_resolution_clock::now();
+        for(int ply = 0; ply < determinizations; ++ply){
+            const int warm = duct.root_visits();
+            duct.search(rollouts);
+            // 走访问最多的着法(best_root_move), 留下的是搜得最多的子树; 走暗子时这步的访问按翻出来的子分到几个信息集, 只留下看到的那个
+            const board::_DUCT::Move best = duct.best();
+            int visits = 0;
+            for(const auto& stat: duct.root_moves)
+                if(stat.first.from == best.from && stat.first.to == best.to) visits = stat.second.count;
+            const unsigned char from_piece = truth.ply1.board[best.from], to_piece = truth.ply1.board[best.to];
+            const char revealed = board::_MCTS::is_dark(from_piece) ? truth.det[best.from] : 0;
+            const char captured = board::_MCTS::is_dark(to_piece) ? truth.det[best.to] : 0;
+            truth.move(best.from, best.to);
+            const int result = game.play(best.from, best.to, revealed, captured);
+            const bool kept = duct.advance(best, game.ply1.board_zobrist);
+            printf("ply %2d: %s%s%s, warm = %6d, visits = %6d, kept = %6d (%s), nodes = %zu\n", ply + 1, ucci(best.from).c_str(), ucci(best.to).c_str(),
+                   revealed ? "(翻)" : "", warm, visits, duct.root_visits(), kept ? "yes" : "no", duct.nodes.size());
+            if(result != MCTSSim::DeterminizedSimulator::unterminated) break;
+        }
+        const double reuse_ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - reuse_start).count() / 1000.0;
+        printf("reuse, %s playout, %d plies x %d iterations, time = %.1f ms\n", mode, determinizations, rollouts, reuse_ms);
+        return 0;
+    }
+    std::vector<std::pair<board::_DUCT::Move, board::_DUCT::stats> > moves;
+    size_t nodes = 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+    if(strcmp(engine, "ismcts") == 0){
+        const uint32_t seed = 20250420u;
+        board::_MCTS::Randomizer rng((const char*)&seed, (const char*)(&seed + 1));
+        MCTSSim::DeterminizedSimulator ismcts_sim(sim);
+        ismcts_sim.rng = &rng;
+        board::_DUCT::ISMCTS duct(&ismcts_sim);
+        duct.policy = policy;
+        duct.search(determinizations * rollouts);
+        moves = duct.root_moves;
+        nodes = duct.nodes.size();
+        threads = 1;
+    }else if(strcmp(engine, "tree") == 0){
+        board::_DUCT::TreeParallelDUCT duct;
+        duct.policy = policy;
+        duct.run(sim, determinizations, rollouts, threads, 20250420u);
+        moves = duct.root_moves;
+        nodes = duct.nodes;
+    }else{
+        board::_DUCT::RootParallelDUCT duct;
+        duct.policy = policy;
+        duct.run(sim, determinizations, rollouts, threads, 20250420u);
+        moves = duct.root_moves;
+        nodes = duct.nodes;
+    }
+    const double ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000.0;
+    const board::_DUCT::Move best = board::_DUCT::best_root_move(moves);
+    std::sort(moves.begin(), moves.end(), [](const auto& a, const auto& b){ return a.second.count > b.second.count; });
+    for(const auto& move: moves){
+        printf("%s%s count = %6d, eval = %+.4f\n", ucci(move.first.from).c_str(), ucci(move.first.to).c_str(), move.second.count, move.second.avg_eval);
+    }
+    printf("best = %s%s, %s, %s playout, %d determinizations x %d rollouts, %d threads, nodes = %zu, time = %.1f ms, determinizations/s = %.1f, rollouts/s = %.0f\n",
+           ucci(best.from).c_str(), ucci(best.to).c_str(), engine, mode, determinizations, rollouts, threads, nodes, ms,
+           determinizations * 1000.0 / (ms > 0 ? ms : 1), (double)determinizations * rollouts * 1000.0 / (ms > 0 ? ms : 1));
     return 0;
-}
\ No newline at end of file
+}